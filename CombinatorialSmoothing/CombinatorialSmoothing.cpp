@@ -29,34 +29,48 @@ DAMAGE.
 #include <Misha/CmdLineParser.h>
 #include "PreProcessing.h"
 #include "DynamicMeshViewer.h"
+#include "ExplicitLaplacianIntegrator.h"
+#include "CombinatorialLaplacian.h"
 
 using namespace MishaK;
 using namespace MishaK::AdvancedGraphics;
 
 CmdLineParameter< std::string >
 	In( "in" ) , 
-	Transform( "xForm" );
+	Transform( "xForm" ) ,
+	Reorder( "reorder" ) ,
+	Solver( "solver" , "direct" );
 
 CmdLineParameter< unsigned int >
 	Width( "width" , 640 ) ,
-	Height( "height" , 480 );
+	Height( "height" , 480 ) ,
+	Steps( "steps" , 1 ) ,
+	Iterations( "iters" , 1000 );
 
 CmdLineParameter< double >
-	StepSize( "stepSize" , 1e-4 );
+	StepSize( "stepSize" , 1e-4 ) ,
+	Tolerance( "tolerance" , 1e-8 );
 
 CmdLineReadable
 	GouraudShading( "gouraud" ) ,
-	Implicit( "implicit" );
+	Implicit( "implicit" ) ,
+	SinglePrecision( "float" );
 
 std::vector< CmdLineReadable* > params =
 {
 	&In ,
 	&Transform ,
+	&Reorder ,
 	&Width ,
 	&Height ,
 	&StepSize ,
+	&Steps ,
+	&Solver ,
+	&Tolerance ,
+	&Iterations ,
 	&GouraudShading ,
-	&Implicit
+	&Implicit ,
+	&SinglePrecision
 };
 
 void ShowUsage( std::string ex )
@@ -64,110 +78,166 @@ void ShowUsage( std::string ex )
 	std::cout << "Usage: " << ex << std::endl;
 	std::cout << "\t --" << In.name << " <input geometry>" << std::endl;
 	std::cout << "\t[--" << Transform.name << " <transform>]" << std::endl;
+	std::cout << "\t[--" << Reorder.name << " <vertex reordering: morton/rcm>]" << std::endl;
 	std::cout << "\t[--" << Width.name << " <width> = " << Width.value << "]" << std::endl;
 	std::cout << "\t[--" << Height.name << " <height> = " << Height.value << "]" << std::endl;
 	std::cout << "\t[--" << StepSize.name << " <gradient descent step size> = " << StepSize.value << "]" << std::endl;
+	std::cout << "\t[--" << Steps.name << " <explicit steps per frame> = " << Steps.value << "]" << std::endl;
+	std::cout << "\t[--" << Solver.name << " <implicit solver type: direct/jacobi/ichol/multigrid> = " << Solver.value << "]" << std::endl;
+	std::cout << "\t[--" << Tolerance.name << " <iterative solver tolerance> = " << Tolerance.value << "]" << std::endl;
+	std::cout << "\t[--" << Iterations.name << " <maximum iterative solver iterations> = " << Iterations.value << "]" << std::endl;
 	std::cout << "\t[--" << GouraudShading.name << "]" << std::endl;
 	std::cout << "\t[--" << Implicit.name << "]" << std::endl;
+	std::cout << "\t[--" << SinglePrecision.name << "]" << std::endl;
 }
 
-struct CombinatorialSmoothingViewer : public DynamicMeshViewer
+template< typename Real >
+struct CombinatorialSmoothingViewer : public DynamicMeshViewerT< Real >
 {
-	CombinatorialSmoothingViewer( Mesh & mesh , double stepSize , bool implicit , DynamicMeshViewer::Parameters parameters )
-		: DynamicMeshViewer( mesh , parameters )
+	using DynamicMeshViewerT< Real >::info;
+	using DynamicMeshViewerT< Real >::visualizationNeedsUpdating;
+
+	// [NOTE] The system is assembled and solved in double precision, regardless of the mesh's scalar type
+	CombinatorialSmoothingViewer( MeshT< Real > & mesh , double stepSize , bool implicit , unsigned int steps , SystemSolver::Type solverType , double tolerance , unsigned int maxIterations , typename DynamicMeshViewerT< Real >::Parameters parameters )
+		: DynamicMeshViewerT< Real >( mesh , parameters )
 		, _mesh(mesh)
 		, _implicit(implicit)
 		, _stepSize(stepSize)
-		, _Id( mesh.vertices.size() , mesh.vertices.size() )
+		, _steps(steps)
+		, _solver( solverType , tolerance , maxIterations )
+		, _integrator(mesh)
 	{
 		_stepSizeIndex = static_cast< unsigned int >( info.size() );
 		info.resize( info.size()+1 );
 		info.back() = std::string( "Stiffness Weight:" ) + std::to_string( _stepSize );
-		_Id.setIdentity();
 
 		// Set the combinatorial Laplacian here
 		Miscellany::PerformanceMeter pMeter( '.' );
 
 
-		int n = _mesh.vertices.size();
-		std::vector< Eigen::Triplet<double> > triplets;
-		for (auto triangle : _mesh.triangles) {
-			for (int i = 0; i < 3; i++) {
-				int vertex1 = triangle[i];
-				int vertex2 = triangle[(i + 1) % 3];
-				triplets.push_back(Eigen::Triplet<double>(vertex1, vertex2, -1.0));
-				triplets.push_back(Eigen::Triplet<double>(vertex2, vertex1, -1.0));
-				triplets.push_back(Eigen::Triplet<double>(vertex1, vertex1, 1.0));
-				triplets.push_back(Eigen::Triplet<double>(vertex2, vertex2, 1.0));
-			}
+		// Assemble the Laplacian directly from the unique edges
+		// [NOTE] The explicit steps apply the Laplacian matrix-free, using the adjacency, so the matrix is only assembled for the implicit solve
+		if( _implicit )
+		{
+			_mesh.setEdges();
+			Eigen::SparseMatrix< double > Id( _mesh.vertices.size() , _mesh.vertices.size() ) , L = CombinatorialLaplacian( _mesh );
+			Id.setIdentity();
+			_solver.compute( Id + _stepSize * L );
 		}
-		_L.resize(n, n);
-		_L.setFromTriplets(triplets.begin(), triplets.end());
-		_solver.compute(_Id + _stepSize * _L);
+		else _mesh.setAdjacency();
 
 		std::cout << pMeter( "Set up system" ) << std::endl;
+		if( _implicit && _solver.type()==SystemSolver::PCG_MULTIGRID )
+		{
+			std::cout << "\tMultigrid levels:";
+			for( size_t l=0 ; l<_solver.multigrid().levels() ; l++ ) std::cout << " " << _solver.multigrid().size(l);
+			std::cout << std::endl;
+		}
+
+		if( _implicit && _solver.iterative() )
+		{
+			_solveIndex = static_cast< unsigned int >( info.size() );
+			info.resize( info.size()+1 );
+		}
 	}
 
 	// Performs the averaging of the geometry/signal
 	void animate( void )
 	{
-		int n = _mesh.vertices.size();
-		Eigen::MatrixXd P (n, 3);
-		for (int i = 0; i < n; i++) {
-			for (int j = 0; j < 3; j++) {
-				P(i, j) = _mesh.vertices[i][j];
-			}
-		}
-		
-		Eigen::MatrixXd P_new;
-		if (_implicit) {
-			P_new = _solver.solve(P);
-		} else {
-			P_new = (_Id - _stepSize * _L) * P; 
+		if( !_implicit )
+		{
+			_integrator.step( _mesh.vertices , _stepSize , _steps );
+			visualizationNeedsUpdating();
+			return;
 		}
 
-		for (int i = 0; i < n; i++) {
-			for (int j = 0; j < 3; j++) {
-				_mesh.vertices[i][j] = P_new(i, j);
-			}
+		// Solve in place, through a view of the vertices
+		// [NOTE] The iterative solvers are warm-started from the current positions
+		auto Solve = [&]( auto & X )
+			{
+				if( _solver.iterative() )
+				{
+					_B = X;
+					_solver.solveWithGuess( _B , X );
+					if( _solver.info()!=Eigen::Success ) MK_WARN( "Solver did not converge: " , _solver.error() );
+					info[ _solveIndex ] = std::string( "Iterations / residual: " ) + std::to_string( _solver.iterations() ) + std::string( " / " ) + std::to_string( _solver.error() );
+				}
+				else _solver.solveInPlace( X );
+			};
+
+		// [NOTE] Single-precision vertices are converted into a persistent double-precision buffer
+		typename MeshT< Real >::PointMap P = _mesh.vertexMap();
+		if constexpr( std::is_same_v< Real , double > ) Solve( P );
+		else
+		{
+			_P = P.template cast< double >();
+			Solve( _P );
+			P = _P.template cast< Real >();
 		}
 
 		visualizationNeedsUpdating();
 	}
 
 protected:
-	unsigned int _stepSizeIndex;
-	Mesh & _mesh;
-	Eigen::SparseMatrix< double > _Id , _L;
-	Eigen::SimplicialLDLT< Eigen::SparseMatrix< double > > _solver;
+	unsigned int _stepSizeIndex , _solveIndex;
+	MeshT< Real > & _mesh;
+	Eigen::MatrixXd _P , _B;
+	SystemSolver _solver;
 	double _stepSize;
+	unsigned int _steps;
 	bool _implicit;
+	ExplicitLaplacianIntegrator< Real > _integrator;
 };
 
-int main( int argc , char* argv[] )
+template< typename Real >
+void Execute( int argc , char* argv[] )
 {
-	CmdLineParse( argc-1 , argv+1 , params );
-	if( !In.set )
+	MeshT< Real > mesh( In.value );
+	std::cout << "Vertices / Triangles: " << mesh.vertices.size() << " / " << mesh.triangles.size() << std::endl;
+
+	if( Reorder.set )
 	{
-		ShowUsage( argv[0] );
-		return EXIT_FAILURE;
-	}
+		unsigned int type = 0;
+		while( type<MeshT< Real >::ReorderTypeNames.size() && MeshT< Real >::ReorderTypeNames[type]!=Reorder.value ) type++;
+		if( type==MeshT< Real >::ReorderTypeNames.size() ) MK_THROW( "Unrecognized reorder type: " , Reorder.value );
 
-	DynamicMeshViewer::OutputMouseInterfaceControls( std::cout );
+		size_t bandwidth = mesh.bandwidth() , profile = mesh.profile();
+		Miscellany::PerformanceMeter pMeter( '.' );
+		mesh.reorder( static_cast< typename MeshT< Real >::ReorderType >( type ) );
+		std::cout << pMeter( "Reordered" ) << std::endl;
+		std::cout << "Bandwidth: " << bandwidth << " -> " << mesh.bandwidth() << std::endl;
+		std::cout << "Profile: " << profile << " -> " << mesh.profile() << std::endl;
+	}
 
-	Mesh mesh( In.value );
-	std::cout << "Vertices / Triangles: " << mesh.vertices.size() << " / " << mesh.triangles.size() << std::endl;
+	unsigned int solverType = 0;
+	while( solverType<SystemSolver::TypeNames.size() && SystemSolver::TypeNames[solverType]!=Solver.value ) solverType++;
+	if( solverType==SystemSolver::TypeNames.size() ) MK_THROW( "Unrecognized solver type: " , Solver.value );
 
-	DynamicMeshViewer::Parameters parameters;
+	typename DynamicMeshViewerT< Real >::Parameters parameters;
 	parameters.flatShading = !GouraudShading.set;
-	parameters.selectionType = DynamicMeshViewer::SelectionType::NONE;
+	parameters.selectionType = DynamicMeshViewerT< Real >::SelectionType::NONE;
 	parameters.valueNormalizationFunction = []( double v ){ return ( v + 1. ) / 2.; };
-	CombinatorialSmoothingViewer v( mesh , StepSize.value , Implicit.set , parameters );
+	CombinatorialSmoothingViewer< Real > v( mesh , StepSize.value , Implicit.set , Steps.value , static_cast< SystemSolver::Type >( solverType ) , Tolerance.value , Iterations.value , parameters );
 
 	v.screenWidth = Width.value;
 	v.screenHeight = Height.value;
 	if( Transform.set ) v.readXForm( Transform.value );
 
-	CombinatorialSmoothingViewer::Viewer::Run( &v , argc , argv , "Combinatorial Smoothing: " + In.value );
+	CombinatorialSmoothingViewer< Real >::Viewer::Run( &v , argc , argv , "Combinatorial Smoothing: " + In.value );
+}
+
+int main( int argc , char* argv[] )
+{
+	CmdLineParse( argc-1 , argv+1 , params );
+	if( !In.set )
+	{
+		ShowUsage( argv[0] );
+		return EXIT_FAILURE;
+	}
+
+	DynamicMeshViewer::OutputMouseInterfaceControls( std::cout );
+
+	if( SinglePrecision.set ) Execute< float >( argc , argv );
+	else                      Execute< double >( argc , argv );
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
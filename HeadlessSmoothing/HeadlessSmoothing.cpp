@@ -0,0 +1,283 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#include <Misha/CmdLineParser.h>
+#include <Misha/Miscellany.h>
+#include "PreProcessing.h"
+#include "Mesh.h"
+#include "RiemannianMesh.h"
+#include "CombinatorialLaplacian.h"
+#include "OneRingAverager.h"
+#include "ExplicitLaplacianIntegrator.h"
+
+using namespace MishaK;
+using namespace MishaK::AdvancedGraphics;
+
+// The smoothing operators that can be run
+enum OperatorType
+{
+	ONE_RING ,
+	COMBINATORIAL ,
+	LAPLACIAN
+};
+const std::vector< std::string > OperatorTypeNames = { "oneRing" , "combinatorial" , "laplacian" };
+
+CmdLineParameter< std::string >
+	In( "in" ) , 
+	Out( "out" ) ,
+	Operator( "operator" , OperatorTypeNames[ONE_RING] ) ,
+	Reorder( "reorder" ) ,
+	Solver( "solver" , "direct" );
+
+CmdLineParameter< unsigned int >
+	Frames( "frames" , 100 ) ,
+	Iterations( "iters" , 1000 );
+
+CmdLineParameter< double >
+	Lambda( "lambda" , 1. ) ,
+	StepSize( "stepSize" , 1e-4 ) ,
+	Tolerance( "tolerance" , 1e-8 );
+
+CmdLineReadable
+	SmoothValues( "values" ) ,
+	Implicit( "implicit" ) ,
+	UpdateMass( "updateMass" ) ,
+	UpdateStiffness( "updateStiffness" ) ,
+	Normalize( "normalize" ) ,
+	SinglePrecision( "float" );
+
+std::vector< CmdLineReadable* > params =
+{
+	&In ,
+	&Out ,
+	&Operator ,
+	&Reorder ,
+	&Solver ,
+	&Frames ,
+	&Iterations ,
+	&Lambda ,
+	&StepSize ,
+	&Tolerance ,
+	&SmoothValues ,
+	&Implicit ,
+	&UpdateMass ,
+	&UpdateStiffness ,
+	&Normalize ,
+	&SinglePrecision
+};
+
+void ShowUsage( std::string ex )
+{
+	std::cout << "Usage: " << ex << std::endl;
+	std::cout << "\t --" << In.name << " <input geometry>" << std::endl;
+	std::cout << "\t[--" << Out.name << " <output geometry>]" << std::endl;
+	std::cout << "\t[--" << Operator.name << " <smoothing operator: oneRing/combinatorial/laplacian> = " << Operator.value << "]" << std::endl;
+	std::cout << "\t[--" << Reorder.name << " <vertex reordering: morton/rcm>]" << std::endl;
+	std::cout << "\t[--" << Solver.name << " <implicit solver type: direct/jacobi/ichol/multigrid> = " << Solver.value << "]" << std::endl;
+	std::cout << "\t[--" << Frames.name << " <number of smoothing iterations> = " << Frames.value << "]" << std::endl;
+	std::cout << "\t[--" << Iterations.name << " <maximum iterative solver iterations> = " << Iterations.value << "]" << std::endl;
+	std::cout << "\t[--" << Lambda.name << " <one-ring blending weight> = " << Lambda.value << "]" << std::endl;
+	std::cout << "\t[--" << StepSize.name << " <step-size> = " << StepSize.value << "]" << std::endl;
+	std::cout << "\t[--" << Tolerance.name << " <iterative solver tolerance> = " << Tolerance.value << "]" << std::endl;
+	std::cout << "\t[--" << SmoothValues.name << "]" << std::endl;
+	std::cout << "\t[--" << Implicit.name << "]" << std::endl;
+	std::cout << "\t[--" << UpdateMass.name << "]" << std::endl;
+	std::cout << "\t[--" << UpdateStiffness.name << "]" << std::endl;
+	std::cout << "\t[--" << Normalize.name << "]" << std::endl;
+	std::cout << "\t[--" << SinglePrecision.name << "]" << std::endl;
+}
+
+template< typename Real >
+void Execute( void )
+{
+	unsigned int operatorType = 0;
+	while( operatorType<OperatorTypeNames.size() && OperatorTypeNames[operatorType]!=Operator.value ) operatorType++;
+	if( operatorType==OperatorTypeNames.size() ) MK_THROW( "Unrecognized operator type: " , Operator.value );
+
+	unsigned int solverType = 0;
+	while( solverType<SystemSolver::TypeNames.size() && SystemSolver::TypeNames[solverType]!=Solver.value ) solverType++;
+	if( solverType==SystemSolver::TypeNames.size() ) MK_THROW( "Unrecognized solver type: " , Solver.value );
+
+	Miscellany::PerformanceMeter pMeter( '.' );
+
+	MeshT< Real > mesh( In.value );
+	std::cout << pMeter( "Read" ) << std::endl;
+	std::cout << "Vertices / Triangles: " << mesh.vertices.size() << " / " << mesh.triangles.size() << std::endl;
+
+	if( Reorder.set )
+	{
+		unsigned int type = 0;
+		while( type<MeshT< Real >::ReorderTypeNames.size() && MeshT< Real >::ReorderTypeNames[type]!=Reorder.value ) type++;
+		if( type==MeshT< Real >::ReorderTypeNames.size() ) MK_THROW( "Unrecognized reorder type: " , Reorder.value );
+
+		size_t bandwidth = mesh.bandwidth() , profile = mesh.profile();
+		pMeter.reset();
+		mesh.reorder( static_cast< typename MeshT< Real >::ReorderType >( type ) );
+		std::cout << pMeter( "Reordered" ) << std::endl;
+		std::cout << "Bandwidth: " << bandwidth << " -> " << mesh.bandwidth() << std::endl;
+		std::cout << "Profile: " << profile << " -> " << mesh.profile() << std::endl;
+	}
+
+	if( SmoothValues.set && operatorType!=ONE_RING ) MK_THROW( "Values can only be smoothed with the " , OperatorTypeNames[ONE_RING] , " operator" );
+	if( SmoothValues.set && !mesh.values.size() )
+	{
+		if( !mesh.colors.size() ) MK_THROW( "Neither values nor colors provided" );
+		mesh.values.resize( mesh.colors.size() );
+		for( unsigned int i=0 ; i<mesh.values.size() ; i++ ) mesh.values[i] = static_cast< Real >( Point< double , 3 >::Dot( mesh.colors[i] , Point< double , 3 >( 1./3 , 1./3 , 1./3 ) ) / 255. );
+	}
+
+	// The state of the operators
+	// [NOTE] The systems are assembled and solved in double precision, regardless of the mesh's scalar type
+	OneRingAverager< Real > averager( mesh );
+	ExplicitLaplacianIntegrator< Real > integrator( mesh );
+	std::unique_ptr< RiemannianMesh::Assembler< Real > > assembler;
+	SystemSolver solver( static_cast< SystemSolver::Type >( solverType ) , Tolerance.value , Iterations.value );
+	Eigen::SparseMatrix< double > mass , stiffness , system;
+	Eigen::Matrix< double , Eigen::Dynamic , Eigen::Dynamic , Eigen::RowMajor > x , rhs;
+	unsigned long long solverIterations = 0;
+	bool implicit = false;
+
+	// Solves the system, warm-started from the current positions, and writes the solution back into the vertices
+	auto Solve = [&]( void )
+		{
+			x = mesh.vertexMap().template cast< double >();
+			solver.solveWithGuess( rhs , x );
+			if( solver.info()!=Eigen::Success ) MK_WARN( "Solver did not converge: " , solver.error() );
+			solverIterations += solver.iterations();
+			mesh.vertexMap() = x.template cast< Real >();
+		};
+
+	// Sets the system matrix M + stepSize * S, using the fact that the mass and stiffness matrices share their sparsity pattern
+	auto SetSystemMatrix = [&]( void )
+		{
+			if( system.nonZeros()!=mass.nonZeros() ) system = mass;
+			const Eigen::Index nnz = mass.nonZeros();
+			Eigen::Map< Eigen::VectorXd >( system.valuePtr() , nnz ) = Eigen::Map< const Eigen::VectorXd >( mass.valuePtr() , nnz ) + Eigen::Map< const Eigen::VectorXd >( stiffness.valuePtr() , nnz ) * StepSize.value;
+		};
+
+	std::function< void ( void ) > Step;
+	pMeter.reset();
+	switch( operatorType )
+	{
+		case ONE_RING:
+			mesh.setAdjacency();
+			if( SmoothValues.set ) Step = [&]( void ){ averager.average( mesh.values , Lambda.value ); };
+			else
+			{
+				mesh.setSoAVertices();
+				Step = [&]( void ){ averager.average( mesh.soaVertices , Lambda.value ); };
+			}
+			break;
+		case COMBINATORIAL:
+			if( Implicit.set )
+			{
+				Eigen::SparseMatrix< double > I( mesh.vertices.size() , mesh.vertices.size() );
+				I.setIdentity();
+				mesh.setEdges();
+				solver.compute( I + CombinatorialLaplacian( mesh ) * StepSize.value );
+				if( solver.info()!=Eigen::Success ) MK_THROW( "Failed to factorize matrix" );
+				implicit = true;
+				Step = [&]( void ){ rhs = mesh.vertexMap().template cast< double >() ; Solve(); };
+			}
+			else
+			{
+				mesh.setAdjacency();
+				Step = [&]( void ){ integrator.step( mesh.vertices , StepSize.value ); };
+			}
+			break;
+		case LAPLACIAN:
+			// So that the results of the computation do not depend on the scale, normalize
+			mesh.normalize();
+			assembler = std::make_unique< RiemannianMesh::Assembler< Real > >( mesh );
+			assembler->mass( mass );
+			assembler->stiffness( stiffness );
+			SetSystemMatrix();
+			solver.compute( system );
+			if( solver.info()!=Eigen::Success ) MK_THROW( "Failed to factorize matrix" );
+			implicit = true;
+			Step = [&]( void )
+				{
+					if( UpdateMass.set || UpdateStiffness.set )
+					{
+						if( UpdateMass.set ) assembler->mass( mass );
+						if( UpdateStiffness.set ) assembler->stiffness( stiffness );
+						SetSystemMatrix();
+						solver.refactorize( system );
+						if( solver.info()!=Eigen::Success ) MK_THROW( "Failed to factorize matrix" );
+					}
+					rhs.noalias() = mass * mesh.vertexMap().template cast< double >();
+					Solve();
+					if( Normalize.set ) mesh.normalize();
+				};
+			break;
+	}
+	std::cout << pMeter( "Set up" ) << std::endl;
+	if( implicit ) std::cout << "\tSymbolic / numerical: " << solver.analysisTime() << " / " << solver.factorizationTime() << " (s)" << std::endl;
+
+	double t = Miscellany::Time();
+	for( unsigned int f=0 ; f<Frames.value ; f++ ) Step();
+	t = Miscellany::Time() - t;
+	std::cout << pMeter( "Smoothed" ) << std::endl;
+
+	if( mesh.hasSoAVertices() ) mesh.updateVerticesFromSoA();
+
+	std::cout << "Frames: " << Frames.value << std::endl;
+	std::cout << "Time per frame: " << ( Frames.value ? t / Frames.value * 1000. : 0. ) << " (ms)" << std::endl;
+	std::cout << "Throughput: " << ( t>0 ? static_cast< double >( mesh.vertices.size() ) * Frames.value / t / 1e6 : 0. ) << " (M vertices / s)" << std::endl;
+	if( implicit && solver.iterative() ) std::cout << "Solver iterations per frame: " << ( Frames.value ? static_cast< double >( solverIterations ) / Frames.value : 0. ) << std::endl;
+
+	if( Out.set )
+	{
+		pMeter.reset();
+		if( Reorder.set ) mesh.restoreOrder();
+		mesh.write( Out.value );
+		std::cout << pMeter( "Wrote" ) << std::endl;
+	}
+}
+
+int main( int argc , char* argv[] )
+{
+	CmdLineParse( argc-1 , argv+1 , params );
+	if( !In.set )
+	{
+		ShowUsage( argv[0] );
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		if( SinglePrecision.set ) Execute< float >();
+		else                      Execute< double >();
+	}
+	catch( const Exception & e )
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
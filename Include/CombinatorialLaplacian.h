@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <Eigen/Sparse>
+#include <Misha/MultiThreading.h>
+#include <Misha/Trace.h>
+#include "Mesh.h"
+
+namespace MishaK
+{
+	namespace AdvancedGraphics
+	{
+		// Returns the combinatorial Laplacian of the mesh, assembled directly in compressed column form from the list of unique edges
+		// -- The weight of an edge is the number of triangles containing it (so that interior edges have weight two)
+		// -- The off-diagonal entries are the negated edge weights and the diagonal entries are the (weighted) vertex degrees
+		// -- If normalize is set, each row is scaled by the inverse of its diagonal, giving the uniform Laplacian I - D^{-1} A
+		//    (which is not symmetric in general)
+		// [NOTE] Mesh::setEdges needs to have been called before invoking
+		template< typename Real >
+		Eigen::SparseMatrix< double > CombinatorialLaplacian( const MeshT< Real > & mesh , bool normalize=false )
+		{
+			MK_TRACE_SCOPE( "CombinatorialLaplacian" );
+			using StorageIndex = typename Eigen::SparseMatrix< double >::StorageIndex;
+			const size_t vNum = mesh.vertices.size() , eNum = mesh.numEdges();
+			if( vNum>static_cast< size_t >( std::numeric_limits< StorageIndex >::max() ) ) MK_THROW( "Too many vertices for the storage index: " , vNum );
+
+			// Count the number of triangles containing each edge and the number of edges incident on each vertex
+			std::vector< std::atomic< unsigned int > > weights( eNum ) , degrees( vNum );
+			ThreadPool::ParallelFor( 0 , eNum , [&]( size_t e ){ weights[e].store( 0 , std::memory_order_relaxed ); } );
+			ThreadPool::ParallelFor( 0 , vNum , [&]( size_t v ){ degrees[v].store( 0 , std::memory_order_relaxed ); } );
+			ThreadPool::ParallelFor
+				(
+					0 , mesh.triangles.size() ,
+					[&]( size_t t )
+					{
+						SimplexIndex< 2 > edges = mesh.triangleEdges( static_cast< unsigned int >( t ) );
+						for( unsigned int k=0 ; k<3 ; k++ ) weights[ edges[k] ].fetch_add( 1 , std::memory_order_relaxed );
+					}
+				);
+			ThreadPool::ParallelFor
+				(
+					0 , eNum ,
+					[&]( size_t e )
+					{
+						std::pair< unsigned int , unsigned int > edge = mesh.edge( static_cast< unsigned int >( e ) );
+						degrees[ edge.first ].fetch_add( 1 , std::memory_order_relaxed );
+						degrees[ edge.second ].fetch_add( 1 , std::memory_order_relaxed );
+					}
+				);
+
+			// Each column stores the diagonal followed by the off-diagonal entries
+			Eigen::SparseMatrix< double > L( vNum , vNum );
+			L.resizeNonZeros( static_cast< Eigen::Index >( vNum + 2*eNum ) );
+			StorageIndex * outer = L.outerIndexPtr() , * inner = L.innerIndexPtr();
+			double * values = L.valuePtr();
+			outer[vNum] = ThreadPool::ParallelScan< StorageIndex >( 0 , vNum , [&]( size_t v ){ return 1 + static_cast< StorageIndex >( degrees[v].load( std::memory_order_relaxed ) ); } , [&]( size_t v , StorageIndex o ){ outer[v] = o; } , ThreadPool::ScanType::EXCLUSIVE );
+
+			// Scatter the off-diagonal entries, using the degrees as (atomic) cursors into the columns
+			ThreadPool::ParallelFor( 0 , vNum , [&]( size_t v ){ degrees[v].store( outer[v]+1 , std::memory_order_relaxed ); } );
+			ThreadPool::ParallelFor
+				(
+					0 , eNum ,
+					[&]( size_t e )
+					{
+						std::pair< unsigned int , unsigned int > edge = mesh.edge( static_cast< unsigned int >( e ) );
+						const double w = -static_cast< double >( weights[e].load( std::memory_order_relaxed ) );
+						size_t idx;
+						idx = degrees[ edge.first ].fetch_add( 1 , std::memory_order_relaxed );
+						inner[idx] = static_cast< StorageIndex >( edge.second ) , values[idx] = w;
+						idx = degrees[ edge.second ].fetch_add( 1 , std::memory_order_relaxed );
+						inner[idx] = static_cast< StorageIndex >( edge.first ) , values[idx] = w;
+					}
+				);
+
+			// Set the diagonal, (optionally) normalize, and sort the entries within each column
+			std::vector< double > diagonal( vNum );
+			ThreadPool::ParallelFor
+				(
+					0 , vNum ,
+					[&]( size_t v )
+					{
+						double d = 0;
+						for( StorageIndex j=outer[v]+1 ; j<outer[v+1] ; j++ ) d -= values[j];
+						inner[ outer[v] ] = static_cast< StorageIndex >( v ) , values[ outer[v] ] = d;
+						diagonal[v] = d;
+					}
+				);
+
+			ThreadPool::ParallelFor
+				(
+					0 , vNum ,
+					[&]( size_t v )
+					{
+						const StorageIndex begin = outer[v] , end = outer[v+1];
+						if( normalize ) for( StorageIndex j=begin ; j<end ; j++ ) if( diagonal[ inner[j] ] ) values[j] /= diagonal[ inner[j] ];
+
+						// Insertion sort, as the columns are short
+						for( StorageIndex j=begin+1 ; j<end ; j++ )
+						{
+							StorageIndex i = inner[j];
+							double value = values[j];
+							StorageIndex k = j;
+							for( ; k>begin && inner[k-1]>i ; k-- ) inner[k] = inner[k-1] , values[k] = values[k-1];
+							inner[k] = i , values[k] = value;
+						}
+					}
+				);
+			return L;
+		}
+	}
+}
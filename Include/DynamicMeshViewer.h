@@ -40,8 +40,16 @@ namespace MishaK
 {
 	namespace AdvancedGraphics
 	{
-		struct DynamicMeshViewer : public Visualization::Viewable< DynamicMeshViewer >
+		// A viewer for a mesh whose vertex attributes are stored using the prescribed scalar type
+		template< typename RealType >
+		struct DynamicMeshViewerT : public Visualization::Viewable< DynamicMeshViewerT< RealType > >
 		{
+			using Visualization::Viewable< DynamicMeshViewerT< RealType > >::screenWidth;
+			using Visualization::Viewable< DynamicMeshViewerT< RealType > >::screenHeight;
+			using Visualization::Viewable< DynamicMeshViewerT< RealType > >::info;
+			using Visualization::Viewable< DynamicMeshViewerT< RealType > >::promptCallBack;
+			using Visualization::Viewable< DynamicMeshViewerT< RealType > >::addCallBack;
+
 			enum SelectionType
 			{
 				NONE ,
@@ -157,8 +165,8 @@ namespace MishaK
 			//////////////////////
 
 			// Constructor/desctructor
-			DynamicMeshViewer( const Mesh & mesh , Parameters parameters );
-			~DynamicMeshViewer( void ){ delete[] _vboBuffer; }
+			DynamicMeshViewerT( const MeshT< RealType > & mesh , Parameters parameters );
+			~DynamicMeshViewerT( void ){ delete[] _vboBuffer; }
 
 			// Rendering call-back
 			void display( void );
@@ -188,10 +196,11 @@ namespace MishaK
 			void visualizationNeedsUpdating( void );
 
 		protected:
-			const Mesh & _mesh;
+			const MeshT< RealType > & _mesh;
 
+			// The vertex buffer is stored in single precision, regardless of the mesh's scalar type
 			size_t _vNum;
-			double * _vboBuffer;
+			GLfloat * _vboBuffer;
 
 			Parameters _parameters;
 			Camera _camera;
@@ -215,6 +224,12 @@ namespace MishaK
 			unsigned int _colorMapID;
 			bool _visualizationNeedsUpdating;
 
+			// The vertices under the selection sphere and their weights (persistent so that dragging does not re-allocate every frame)
+			std::vector< std::pair< unsigned int , double > > _selection;
+
+			// Returns the position of the v-th vertex, read from the structure-of-arrays representation if it is available
+			Point3D< double > _position( unsigned int v ) const;
+
 			void _setTranslateAndScale( void );
 			Point3D< double > _cameraToWorld( Point3D< double > p , bool direction=false ) const;
 			Point3D< double > _worldToCamera( Point3D< double > p , bool direction=false ) const;
@@ -236,6 +251,9 @@ namespace MishaK
 			void _toggleTransformMode( std::string );
 			void _drawSelectionSphere( Point3D< double > p , double r );
 		};
+
+		using DynamicMeshViewer = DynamicMeshViewerT< double >;
+
 #include "DynamicMeshViewer.inl"
 	}
 }
\ No newline at end of file
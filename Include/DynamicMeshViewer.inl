@@ -26,14 +26,16 @@ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF S
 DAMAGE.
 */
 
-const std::vector< std::string > DynamicMeshViewer::selectionTypeNames =
+template< typename RealType >
+const std::vector< std::string > DynamicMeshViewerT< RealType >::selectionTypeNames =
 {
 	"none" ,
 	"click" ,
 	"drag"
 };
 
-inline DynamicMeshViewer::Parameters::Parameters
+template< typename RealType >
+inline DynamicMeshViewerT< RealType >::Parameters::Parameters
 (
 	SelectionType selectionType ,
 	bool flatShading ,
@@ -46,7 +48,8 @@ inline DynamicMeshViewer::Parameters::Parameters
 	: selectionType(selectionType) , flatShading(flatShading) , bands(bands) , bandEpsilon(bandEpsilon) , dualBand(dualBand) , grayScale(grayScale) , valueNormalizationFunction(valueNormalizationFunction)
 {}
 
-inline DynamicMeshViewer::DynamicMeshViewer( const Mesh & mesh , Parameters parameters )
+template< typename RealType >
+inline DynamicMeshViewerT< RealType >::DynamicMeshViewerT( const MeshT< RealType > & mesh , Parameters parameters )
 	: _mesh(mesh) , _vboBuffer(nullptr) , _parameters(parameters)
 {
 	// Check that the mesh is in a reasonable state
@@ -80,7 +83,7 @@ inline DynamicMeshViewer::DynamicMeshViewer( const Mesh & mesh , Parameters para
 	_colorMapID = 0;
 
 	_vNum = _parameters.flatShading ? _mesh.triangles.size() * 3 : _mesh.vertices.size();
-	_vboBuffer = new double[ 7 * _vNum ];
+	_vboBuffer = new GLfloat[ 7 * _vNum ];
 
 	_animationIndex = (int)info.size();
 	info.resize( info.size()+1 );
@@ -98,50 +101,66 @@ inline DynamicMeshViewer::DynamicMeshViewer( const Mesh & mesh , Parameters para
 	}
 
 	// Add keyboard call backs
-	addCallBack( 'x' , "save transform" , "Transform" , &DynamicMeshViewer::_setXFormCallBack );
-	addCallBack( 'e' , "toggle edges"                 , &DynamicMeshViewer::_toggleEdgesCallBack );
-	addCallBack( '+' , "advance animation"            , &DynamicMeshViewer::_advanceAnimationCallBack );
-	addCallBack( ' ' , "toggle animation"             , &DynamicMeshViewer::_toggleAnimationCallBack );
-	if( _mesh.values.size() ) addCallBack( 'v' , "toggle values" , &DynamicMeshViewer::_toggleShowValuesCallBack );
+	addCallBack( 'x' , "save transform" , "Transform" , &DynamicMeshViewerT::_setXFormCallBack );
+	addCallBack( 'e' , "toggle edges"                 , &DynamicMeshViewerT::_toggleEdgesCallBack );
+	addCallBack( '+' , "advance animation"            , &DynamicMeshViewerT::_advanceAnimationCallBack );
+	addCallBack( ' ' , "toggle animation"             , &DynamicMeshViewerT::_toggleAnimationCallBack );
+	if( _mesh.values.size() ) addCallBack( 'v' , "toggle values" , &DynamicMeshViewerT::_toggleShowValuesCallBack );
 
 	if( _parameters.selectionType==SelectionType::DRAG )
 	{
-		addCallBack( 's' , "toggle selection mode" , &DynamicMeshViewer::_toggleTransformMode );
-		addCallBack( '}' , "increase selection radius" , &DynamicMeshViewer::_increaseSphereSelectionRadiusCallBack );
-		addCallBack( '{' , "decrease selection radius" , &DynamicMeshViewer::_decreaseSphereSelectionRadiusCallBack );
+		addCallBack( 's' , "toggle selection mode" , &DynamicMeshViewerT::_toggleTransformMode );
+		addCallBack( '}' , "increase selection radius" , &DynamicMeshViewerT::_increaseSphereSelectionRadiusCallBack );
+		addCallBack( '{' , "decrease selection radius" , &DynamicMeshViewerT::_decreaseSphereSelectionRadiusCallBack );
 	}
 }
 
-inline void DynamicMeshViewer::animate( void ){}
-inline void DynamicMeshViewer::selectLeft ( unsigned int vIdx ){}
-inline void DynamicMeshViewer::selectRight( unsigned int vIdx ){}
-inline void DynamicMeshViewer::dragLeft ( unsigned int vIdx , Point3D< double > p ){}
-inline void DynamicMeshViewer::dragRight( unsigned int vIdx , Point3D< double > p ){}
-inline void DynamicMeshViewer::selectLeft ( const std::vector< std::pair< unsigned int , double > > &selection ){}
-inline void DynamicMeshViewer::selectRight( const std::vector< std::pair< unsigned int , double > > &selection ){}
-
-inline void DynamicMeshViewer::_setXFormCallBack( std::string prompt ){ if( prompt.size() ) writeXForm( prompt ); }
-
-inline void DynamicMeshViewer::_toggleEdgesCallBack( std::string ){ showEdges = !showEdges; }
-
-inline void DynamicMeshViewer::_toggleAnimationCallBack( std::string )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::animate( void ){}
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::selectLeft ( unsigned int vIdx ){}
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::selectRight( unsigned int vIdx ){}
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::dragLeft ( unsigned int vIdx , Point3D< double > p ){}
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::dragRight( unsigned int vIdx , Point3D< double > p ){}
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::selectLeft ( const std::vector< std::pair< unsigned int , double > > &selection ){}
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::selectRight( const std::vector< std::pair< unsigned int , double > > &selection ){}
+
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_setXFormCallBack( std::string prompt ){ if( prompt.size() ) writeXForm( prompt ); }
+
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_toggleEdgesCallBack( std::string ){ showEdges = !showEdges; }
+
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_toggleAnimationCallBack( std::string )
 {
 	if( !animationCount ) animationCount = static_cast< unsigned int >(-1);
 	else                  animationCount = 0;
 }
 
-inline void DynamicMeshViewer::_advanceAnimationCallBack( std::string ){ animationCount++; }
-
-inline void DynamicMeshViewer::_decreaseSphereSelectionRadiusCallBack( std::string ){ sphereSelectionRadius /= 1.1; }
-inline void DynamicMeshViewer::_increaseSphereSelectionRadiusCallBack( std::string ){ sphereSelectionRadius *= 1.1; }
-inline void DynamicMeshViewer::_toggleShowValuesCallBack( std::string ){ showValues = !showValues; }
-inline void DynamicMeshViewer::_toggleTransformMode( std::string )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_advanceAnimationCallBack( std::string ){ animationCount++; }
+
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_decreaseSphereSelectionRadiusCallBack( std::string ){ sphereSelectionRadius /= 1.1; }
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_increaseSphereSelectionRadiusCallBack( std::string ){ sphereSelectionRadius *= 1.1; }
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_toggleShowValuesCallBack( std::string ){ showValues = !showValues; }
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_toggleTransformMode( std::string )
 {
 	_selectionMode = !_selectionMode;
 	info[ _selectIndex ] = std::string( "Select: " ) + ( _selectionMode ? std::string( "ON" ) : std::string( "OFF" ) );
 }
 
-inline bool DynamicMeshViewer::writeXForm( std::string fileName ) const
+template< typename RealType >
+inline bool DynamicMeshViewerT< RealType >::writeXForm( std::string fileName ) const
 {
 	std::ofstream out( fileName );
 	if( !out ) return false;
@@ -150,7 +169,8 @@ inline bool DynamicMeshViewer::writeXForm( std::string fileName ) const
 	return static_cast< bool >( out );
 }
 
-inline bool DynamicMeshViewer::readXForm( std::string fileName )
+template< typename RealType >
+inline bool DynamicMeshViewerT< RealType >::readXForm( std::string fileName )
 {
 	std::ifstream in( fileName );
 	if( !in ) return false;
@@ -159,24 +179,44 @@ inline bool DynamicMeshViewer::readXForm( std::string fileName )
 	return static_cast< bool >(in);
 }
 
-inline Point3D< double > DynamicMeshViewer::_cameraToWorld( Point3D< double > p , bool direction ) const
+template< typename RealType >
+inline Point3D< double > DynamicMeshViewerT< RealType >::_cameraToWorld( Point3D< double > p , bool direction ) const
 {
 	if( direction ) return p / _scale;
 	else            return p / _scale - _translate;
 }
-inline Point3D< double > DynamicMeshViewer::_worldToCamera( Point3D< double > p , bool direction ) const
+template< typename RealType >
+inline Point3D< double > DynamicMeshViewerT< RealType >::_worldToCamera( Point3D< double > p , bool direction ) const
 {
 	if( direction ) return ( p              ) * _scale;
 	else            return ( p + _translate ) * _scale;
 }
 
-inline void DynamicMeshViewer::_setTranslateAndScale( void )
+template< typename RealType >
+inline Point3D< double > DynamicMeshViewerT< RealType >::_position( unsigned int v ) const
 {
-	Point3D< double > bBox[2];
+	if( _mesh.hasSoAVertices() ) return Point3D< double >( _mesh.soaVertices[0][v] , _mesh.soaVertices[1][v] , _mesh.soaVertices[2][v] );
+	else                         return Point3D< double >( _mesh.vertices[v] );
+}
 
-	bBox[0] = bBox[1] = _mesh.vertices[0];
-	for( unsigned int i=0 ; i<_mesh.vertices.size() ; i++ ) for( unsigned int j=0 ; j<3 ; j++ )
-		bBox[0][j] = std::min< double >( bBox[0][j] , _mesh.vertices[i][j] ) , bBox[1][j] = std::max< double >( bBox[1][j] , _mesh.vertices[i][j] );
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_setTranslateAndScale( void )
+{
+	using BoundingBox = std::pair< Point3D< double > , Point3D< double > >;
+	const double infinity = std::numeric_limits< double >::infinity();
+	BoundingBox _bBox = ThreadPool::ParallelReduce
+		(
+			0 , _mesh.vertices.size() ,
+			[&]( size_t v ){ Point3D< double > p = _position( static_cast< unsigned int >(v) ) ; return BoundingBox( p , p ); } ,
+			BoundingBox( Point3D< double >( infinity , infinity , infinity ) , Point3D< double >( -infinity , -infinity , -infinity ) ) ,
+			[]( const BoundingBox & b1 , const BoundingBox & b2 )
+			{
+				BoundingBox b;
+				for( unsigned int j=0 ; j<3 ; j++ ) b.first[j] = std::min< double >( b1.first[j] , b2.first[j] ) , b.second[j] = std::max< double >( b1.second[j] , b2.second[j] );
+				return b;
+			}
+		);
+	Point3D< double > bBox[] = { _bBox.first , _bBox.second };
 
 	// Compute the _translation and _scale bringing the mesh into view
 	Point3D< double > center = ( bBox[0] + bBox[1] ) / 2;
@@ -203,9 +243,11 @@ inline void DynamicMeshViewer::_setTranslateAndScale( void )
 	else                _scale = std::min< double >( 1.f / maxXZ , 1.f / aspectRatio / maxY );
 }
 
-inline void DynamicMeshViewer::setSelectionType( SelectionType selectionType ){ _parameters.selectionType = selectionType; }
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::setSelectionType( SelectionType selectionType ){ _parameters.selectionType = selectionType; }
 
-inline void DynamicMeshViewer::setColorMap( unsigned int res , unsigned int bands , double bandEpsilon , bool dual , bool useGrayScale )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::setColorMap( unsigned int res , unsigned int bands , double bandEpsilon , bool dual , bool useGrayScale )
 {
 	unsigned char * colorValues = new unsigned char[ res * 3 ];
 
@@ -256,19 +298,22 @@ inline void DynamicMeshViewer::setColorMap( unsigned int res , unsigned int band
 	delete[] colorValues;
 }
 
-inline void DynamicMeshViewer::_setVBOBuffer( bool updateBoundingBox , const std::function< double ( double ) > & valueNormalizationFunction )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_setVBOBuffer( bool updateBoundingBox , const std::function< double ( double ) > & valueNormalizationFunction )
 {
+	MK_TRACE_SCOPE( "DynamicMeshViewer::setVBOBuffer" );
 	if( updateBoundingBox ) _setTranslateAndScale();
 
-	memset( _vboBuffer , 0 , sizeof(double) * 7 * _vNum );
+	memset( _vboBuffer , 0 , sizeof(GLfloat) * 7 * _vNum );
 
-	Point3D< double > * vertices = reinterpret_cast< Point3D< double >* >( _vboBuffer + 0 * _vNum );
-	Point3D< double > * normals  = reinterpret_cast< Point3D< double >* >( _vboBuffer + 3 * _vNum );
-	double            * tCoords  =                                         _vboBuffer + 6 * _vNum;
+	Point3D< GLfloat > * vertices = reinterpret_cast< Point3D< GLfloat >* >( _vboBuffer + 0 * _vNum );
+	Point3D< GLfloat > * normals  = reinterpret_cast< Point3D< GLfloat >* >( _vboBuffer + 3 * _vNum );
+	GLfloat            * tCoords  =                                          _vboBuffer + 6 * _vNum;
 
 	auto TriangleNormal = [&]( size_t t )
 		{
-			return Point3D< double >::CrossProduct( _mesh.vertices[ _mesh.triangles[t][1] ] - _mesh.vertices[ _mesh.triangles[t][0] ] , _mesh.vertices[ _mesh.triangles[t][2] ] - _mesh.vertices[ _mesh.triangles[t][0] ] );
+			Point3D< double > p0 = _position( _mesh.triangles[t][0] );
+			return Point3D< double >::CrossProduct( _position( _mesh.triangles[t][1] ) - p0 , _position( _mesh.triangles[t][2] ) - p0 );
 		};
 
 	if( _parameters.flatShading )
@@ -306,7 +351,7 @@ inline void DynamicMeshViewer::_setVBOBuffer( bool updateBoundingBox , const std
 		}
 
 		for( unsigned int i=0 , idx=0 ; i<_mesh.triangles.size() ; i++ ) for( unsigned int j=0 ; j<3 ; j++ , idx++ )
-			vertices[idx] = _worldToCamera( _mesh.vertices[ _mesh.triangles[i][j] ] );
+			vertices[idx] = _worldToCamera( _position( _mesh.triangles[i][j] ) );
 	}
 	else
 	{
@@ -320,14 +365,15 @@ inline void DynamicMeshViewer::_setVBOBuffer( bool updateBoundingBox , const std
 
 		for( unsigned int i=0 ; i<_mesh.vertices.size() ; i++ )
 		{
-			vertices[i] = _worldToCamera( _mesh.vertices[i] );
+			vertices[i] = _worldToCamera( _position(i) );
 			normals[i] /= Point3D< double >::Length( normals[i] );
 			if( _mesh.values.size() ) tCoords[i] = valueNormalizationFunction( _mesh.values[i] );
 		}
 	}
 }
 
-inline void DynamicMeshViewer::_initVBO( void )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_initVBO( void )
 {
 	_setVBOBuffer( true , _parameters.valueNormalizationFunction );
 
@@ -343,24 +389,27 @@ inline void DynamicMeshViewer::_initVBO( void )
 
 	glGenBuffers( 1 , &_vbo );
 	glBindBuffer( GL_ARRAY_BUFFER , _vbo );
-	glBufferData( GL_ARRAY_BUFFER , 7 * _vNum * sizeof( double ) , _vboBuffer , GL_DYNAMIC_DRAW );
+	glBufferData( GL_ARRAY_BUFFER , 7 * _vNum * sizeof( GLfloat ) , _vboBuffer , GL_DYNAMIC_DRAW );
 	glBindBuffer( GL_ARRAY_BUFFER , 0 );
 }
 
-inline void DynamicMeshViewer::visualizationNeedsUpdating( void )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::visualizationNeedsUpdating( void )
 {
 	_visualizationNeedsUpdating = true;
 }
 
-inline void DynamicMeshViewer::_updateVBO( void )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_updateVBO( void )
 {
 	_setVBOBuffer( updateBoundingBox , _parameters.valueNormalizationFunction );
 	glBindBuffer( GL_ARRAY_BUFFER , _vbo );
-	glBufferSubData( GL_ARRAY_BUFFER , 0 , 7 * _vNum * sizeof( double ) , _vboBuffer );
+	glBufferSubData( GL_ARRAY_BUFFER , 0 , 7 * _vNum * sizeof( GLfloat ) , _vboBuffer );
 	glBindBuffer( GL_ARRAY_BUFFER , 0 );
 }
 
-inline Point3D< double > DynamicMeshViewer::_mouseDirection( int dx , int  dy ) const
+template< typename RealType >
+inline Point3D< double > DynamicMeshViewerT< RealType >::_mouseDirection( int dx , int  dy ) const
 {
 	double ar = (double)screenWidth/(double)screenHeight ;
 	double _width , _height;
@@ -374,7 +423,8 @@ inline Point3D< double > DynamicMeshViewer::_mouseDirection( int dx , int  dy )
 	return _cameraToWorld( _camera.right * _x + _camera.up * _y  , true );
 }
 
-inline std::optional< Point3D< double > > DynamicMeshViewer::_mousePosition( int x , int  y ) const
+template< typename RealType >
+inline std::optional< Point3D< double > > DynamicMeshViewerT< RealType >::_mousePosition( int x , int  y ) const
 {
 	float depth;
 	glReadPixels( x , screenHeight-1-y , 1 , 1 , GL_DEPTH_COMPONENT , GL_FLOAT , &depth );
@@ -393,7 +443,8 @@ inline std::optional< Point3D< double > > DynamicMeshViewer::_mousePosition( int
 	}
 }
 
-inline unsigned int DynamicMeshViewer::_nearestVertex( int x , int y , Point3D< double > & p ) const
+template< typename RealType >
+inline unsigned int DynamicMeshViewerT< RealType >::_nearestVertex( int x , int y , Point3D< double > & p ) const
 {
 	if( auto _p=_mousePosition(x,y) )
 	{
@@ -402,7 +453,7 @@ inline unsigned int DynamicMeshViewer::_nearestVertex( int x , int y , Point3D<
 		double l2 = std::numeric_limits< double >::infinity();
 		for( unsigned int i=0 ; i<_mesh.vertices.size() ; i++ )
 		{
-			double _l2 = Point3D< double >::SquareNorm( p - _mesh.vertices[i] );
+			double _l2 = Point3D< double >::SquareNorm( p - _position(i) );
 			if( _l2<l2 ) vIdx = i , l2 = _l2;
 		}
 		return vIdx;
@@ -410,7 +461,8 @@ inline unsigned int DynamicMeshViewer::_nearestVertex( int x , int y , Point3D<
 	else return static_cast< unsigned int >(-1);
 }
 
-inline void DynamicMeshViewer::display( void )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::display( void )
 {
 	bool useTexture = _mesh.values.size()!=0 && showValues;
 
@@ -465,9 +517,9 @@ inline void DynamicMeshViewer::display( void )
 	glEnableClientState( GL_VERTEX_ARRAY );
 	glEnableClientState( GL_NORMAL_ARRAY );
 	if( useTexture ) glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-	glVertexPointer( 3 , GL_DOUBLE , 0 , (GLubyte*)NULL + sizeof( double ) * _vNum*0 );
-	glNormalPointer(     GL_DOUBLE , 0 , (GLubyte*)NULL + sizeof( double ) * _vNum*3 );
-	if( useTexture ) glTexCoordPointer( 1 , GL_DOUBLE , 0 , (GLubyte*)NULL + sizeof( double ) * _vNum*6 );
+	glVertexPointer( 3 , GL_FLOAT , 0 , (GLubyte*)NULL + sizeof( GLfloat ) * _vNum*0 );
+	glNormalPointer(     GL_FLOAT , 0 , (GLubyte*)NULL + sizeof( GLfloat ) * _vNum*3 );
+	if( useTexture ) glTexCoordPointer( 1 , GL_FLOAT , 0 , (GLubyte*)NULL + sizeof( GLfloat ) * _vNum*6 );
 
 	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER , _ebo );
 	glDrawElements( GL_TRIANGLES , (GLsizei)(_mesh.triangles.size()*3) , GL_UNSIGNED_INT , NULL );
@@ -500,7 +552,7 @@ inline void DynamicMeshViewer::display( void )
 			glBindBuffer( GL_ARRAY_BUFFER , _vbo );
 			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER , _ebo );
 			glEnableClientState( GL_VERTEX_ARRAY );
-			glVertexPointer( 3 , GL_DOUBLE , 0 , NULL );
+			glVertexPointer( 3 , GL_FLOAT , 0 , NULL );
 			glDrawElements( GL_TRIANGLES , (GLsizei)(_mesh.triangles.size()*3) , GL_UNSIGNED_INT , NULL );
 			glBindBuffer( GL_ARRAY_BUFFER , 0 );
 			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER , 0 );
@@ -522,7 +574,7 @@ inline void DynamicMeshViewer::display( void )
 			glPointSize( 5 );
 			glColor3f( 0.f , 0.f , 0.f );
 			glBegin( GL_POINTS );
-			Point3D< double > p = _worldToCamera( _mesh.vertices[_overVertex] );
+			Point3D< double > p = _worldToCamera( _position( _overVertex ) );
 			p -= _camera.forward/100;
 			glVertex3d( p[0] , p[1] , p[2] );
 			glEnd();
@@ -530,7 +582,8 @@ inline void DynamicMeshViewer::display( void )
 	}
 }
 
-inline void DynamicMeshViewer::_drawSelectionSphere( Point3D< double > p , double r )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::_drawSelectionSphere( Point3D< double > p , double r )
 {
 	const unsigned int ThetaRes = 128 , PhiRes = 64;
 	auto DrawSpherePoint = [&]( unsigned int x , unsigned int y )
@@ -564,7 +617,8 @@ inline void DynamicMeshViewer::_drawSelectionSphere( Point3D< double > p , doubl
 	glDepthMask( GL_TRUE );
 }
 
-inline void DynamicMeshViewer::mouseFunc( int button , int state , int x , int y )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::mouseFunc( int button , int state , int x , int y )
 {
 	_rotating = _scaling = _panning = false;
 
@@ -620,7 +674,7 @@ inline void DynamicMeshViewer::mouseFunc( int button , int state , int x , int y
 		else if( state==GLUT_UP )
 			if( _dragDiscrete )
 			{
-				Point3D< double > p = _mesh.vertices[_overVertex] + _mouseDirection( x - _mouseX , y - _mouseY );
+				Point3D< double > p = _position( _overVertex ) + _mouseDirection( x - _mouseX , y - _mouseY );
 				if( button==GLUT_LEFT_BUTTON  ) dragLeft ( _overVertex , p );
 				if( button==GLUT_RIGHT_BUTTON ) dragRight( _overVertex , p );
 				_dragDiscrete = false;
@@ -628,7 +682,8 @@ inline void DynamicMeshViewer::mouseFunc( int button , int state , int x , int y
 	}
 }
 
-inline void DynamicMeshViewer::motionFunc( int x , int y )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::motionFunc( int x , int y )
 {
 	if( _dragDiscrete ) return;
 
@@ -649,7 +704,8 @@ inline void DynamicMeshViewer::motionFunc( int x , int y )
 }
 
 // Tracks the position of the mouse (in 3D) and the index of the nearest vertex
-inline void DynamicMeshViewer::passiveMotionFunc( int x , int y )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::passiveMotionFunc( int x , int y )
 {
 	_overVertex = _nearestVertex( x , y , _overPosition );
 
@@ -657,8 +713,8 @@ inline void DynamicMeshViewer::passiveMotionFunc( int x , int y )
 	{
 		std::stringstream ss;
 		Miscellany::StreamFloatPrecision sfp( ss , 3 );
-		if( _mesh.values.size() ) ss << "Vertex[" << _overVertex << "]: " << _mesh.vertices[_overVertex] << " / " << _mesh.values[_overVertex];
-		else                      ss << "Vertex[" << _overVertex << "]: " << _mesh.vertices[_overVertex];
+		if( _mesh.values.size() ) ss << "Vertex[" << _overVertex << "]: " << _position( _overVertex ) << " / " << _mesh.values[_overVertex];
+		else                      ss << "Vertex[" << _overVertex << "]: " << _position( _overVertex );
 		info[ _vertexIndex ] = ss.str();
 	}
 	else info[_vertexIndex] = std::string( "Vertex:" );
@@ -666,9 +722,11 @@ inline void DynamicMeshViewer::passiveMotionFunc( int x , int y )
 	glutPostRedisplay();
 }
 
-inline void DynamicMeshViewer::idle( void )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::idle( void )
 {
 	bool redisplay = false;
+
 	if( !promptCallBack )
 	{
 		if( !_dragDiscrete && !_rotating && !_scaling && !_panning && ( _leftButtonDown || _rightButtonDown ) )
@@ -679,17 +737,40 @@ inline void DynamicMeshViewer::idle( void )
 				if( auto p=_mousePosition( _mouseX , _mouseY ) )
 				{
 					double r = sphereSelectionRadius * _boundingRadius;
-					unsigned int vIdx = -1;
-					double l2 = std::numeric_limits< double >::infinity();
-					std::vector< std::pair< unsigned int , double > > selection;
-					for( unsigned int i=0 ; i<_mesh.vertices.size() ; i++ )
-					{
-						double _l2 = Point3D< double >::SquareNorm( *p - _mesh.vertices[i] );
-						if( vIdx==static_cast< unsigned int >(-1) || _l2<l2 ) vIdx = i , l2 = _l2;
-						if( _l2<r*r ) selection.emplace_back( i , ( 1. - sqrt( _l2 )/r ) * dt * 4 );
-					}
-					if( _leftButtonDown  )  selectLeft( selection );
-					if( _rightButtonDown ) selectRight( selection );
+
+					const size_t vNum = _mesh.vertices.size();
+					auto SquareDistance = [&]( size_t i ){ return Point3D< double >::SquareNorm( *p - _position( static_cast< unsigned int >(i) ) ); };
+
+					// Find the nearest vertex, breaking ties in favor of the smaller index so that the result does not depend on the schedule
+					using Nearest = std::pair< double , unsigned int >;
+					unsigned int vIdx = ThreadPool::ParallelReduce
+						(
+							0 , vNum ,
+							[&]( size_t i ){ return Nearest( SquareDistance(i) , static_cast< unsigned int >(i) ); } ,
+							Nearest( std::numeric_limits< double >::infinity() , static_cast< unsigned int >(-1) ) ,
+							[]( const Nearest & n1 , const Nearest & n2 ){ return std::min< Nearest >( n1 , n2 ); }
+						).second;
+
+					// Gather the vertices in the selection sphere, in order, at the offsets given by a scan over the indicator
+					// [NOTE] The vertices are gathered in the calling thread's arena and then copied into the persistent selection
+					ThreadPool::Arena & arena = ThreadPool::ThreadArena();
+					ThreadPool::Arena::Scope scope( arena );
+					std::pair< unsigned int , double > * selected = arena.allocate< std::pair< unsigned int , double > >( vNum );
+					size_t count = ThreadPool::ParallelScan< size_t >
+						(
+							0 , vNum ,
+							[&]( size_t i ){ return SquareDistance(i)<r*r ? (size_t)1 : (size_t)0; } ,
+							[&]( size_t i , size_t offset )
+							{
+								double l2 = SquareDistance(i);
+								if( l2<r*r ) new( selected+offset ) std::pair< unsigned int , double >( static_cast< unsigned int >(i) , ( 1. - sqrt( l2 )/r ) * dt * 4 );
+							} ,
+							ThreadPool::ScanType::EXCLUSIVE
+						);
+					_selection.assign( selected , selected+count );
+
+					if( _leftButtonDown  )  selectLeft( _selection );
+					if( _rightButtonDown ) selectRight( _selection );
 					_overPosition = *p;
 					_overVertex = vIdx;
 					redisplay = true;
@@ -709,8 +790,8 @@ inline void DynamicMeshViewer::idle( void )
 	{
 		std::stringstream ss;
 		Miscellany::StreamFloatPrecision sfp( ss , 3 );
-		if( _mesh.values.size() ) ss << "Vertex[" << _overVertex << "]: " << _mesh.vertices[_overVertex] << " / " << _mesh.values[_overVertex];
-		else                      ss << "Vertex[" << _overVertex << "]: " << _mesh.vertices[_overVertex];
+		if( _mesh.values.size() ) ss << "Vertex[" << _overVertex << "]: " << _position( _overVertex ) << " / " << _mesh.values[_overVertex];
+		else                      ss << "Vertex[" << _overVertex << "]: " << _position( _overVertex );
 		info[ _vertexIndex ] = ss.str();
 	}
 
@@ -719,9 +800,11 @@ inline void DynamicMeshViewer::idle( void )
 	if( redisplay ) glutPostRedisplay();
 }
 
-inline void DynamicMeshViewer::keyboardFunc( unsigned char key , int x , int y ){}
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::keyboardFunc( unsigned char key , int x , int y ){}
 
-inline void DynamicMeshViewer::specialFunc( int key, int x, int y )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::specialFunc( int key, int x, int y )
 {
 	switch( key )
 	{
@@ -734,7 +817,8 @@ inline void DynamicMeshViewer::specialFunc( int key, int x, int y )
 	}
 }
 
-inline void DynamicMeshViewer::OutputMouseInterfaceControls( std::ostream & out )
+template< typename RealType >
+inline void DynamicMeshViewerT< RealType >::OutputMouseInterfaceControls( std::ostream & out )
 {
 	out << "+----------------------------------------+" << std::endl;
 	out << "| Mouse Interface Controls:              |" << std::endl;
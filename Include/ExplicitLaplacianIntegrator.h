@@ -0,0 +1,140 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <Misha/Geometry.h>
+#include <Misha/MultiThreading.h>
+#include "Mesh.h"
+
+namespace MishaK
+{
+	namespace AdvancedGraphics
+	{
+		// An engine for the explicit integration of the combinatorial Laplacian flow:
+		//		x[v] <- x[v] - stepSize * \sum_{w\in N(v)} m(v,w) * ( x[v] - x[w] )
+		// where m(v,w) is the number of triangles containing the edge (v,w) (so that interior edges have weight two)
+		// -- The Laplacian is applied matrix-free, in parallel over the mesh's (compressed) adjacency, with sums accumulated in double precision
+		// -- The results are written into a persistent back buffer that is then swapped with the input, so no per-step allocation or copying is performed
+		// [NOTE] The mesh's adjacency needs to have been set before integrating (the edge weights are computed on first use, and recomputed when the mesh's topology version changes)
+		template< typename Real >
+		struct ExplicitLaplacianIntegrator
+		{
+			static const unsigned int Dim = MeshT< Real >::Dim;
+
+			ExplicitLaplacianIntegrator( const MeshT< Real > & mesh );
+
+			// Performs the requested number of explicit steps on the per-vertex positions
+			void step( std::vector< Point< Real , Dim > > & points , double stepSize , unsigned int steps=1 );
+
+		protected:
+			const MeshT< Real > & _mesh;
+
+			// For each adjacency entry, the number of triangles containing the associated edge
+			std::vector< unsigned int > _weights;
+			std::vector< Point< Real , Dim > > _points;
+
+			// The topology version of the mesh the weights were computed for
+			size_t _version;
+
+			void _setWeights( void );
+		};
+
+		/////////////////////////////////
+		// ExplicitLaplacianIntegrator //
+		/////////////////////////////////
+		template< typename Real >
+		ExplicitLaplacianIntegrator< Real >::ExplicitLaplacianIntegrator( const MeshT< Real > & mesh ) : _mesh(mesh) , _version( static_cast< size_t >(-1) ){}
+
+		template< typename Real >
+		void ExplicitLaplacianIntegrator< Real >::_setWeights( void )
+		{
+			const std::vector< size_t > & offsets = _mesh.adjacencyOffsets();
+			const std::vector< unsigned int > & neighbors = _mesh.adjacencyIndices();
+
+			// Count the triangles containing each edge, in parallel over the triangles
+			// [NOTE] The neighbors of each vertex are sorted, so the adjacency entry of an edge is found by binary search
+			std::vector< std::atomic< unsigned int > > counts( neighbors.size() );
+			ThreadPool::ParallelFor( 0 , counts.size() , [&]( size_t j ){ counts[j].store( 0 , std::memory_order_relaxed ); } );
+			auto Entry = [&]( unsigned int v , unsigned int w ){ return std::lower_bound( neighbors.begin()+offsets[v] , neighbors.begin()+offsets[v+1] , w ) - neighbors.begin(); };
+			ThreadPool::ParallelFor
+				(
+					0 , _mesh.triangles.size() ,
+					[&]( size_t t )
+					{
+						for( unsigned int k=0 ; k<3 ; k++ )
+						{
+							unsigned int v1 = _mesh.triangles[t][k] , v2 = _mesh.triangles[t][(k+1)%3];
+							counts[ Entry( v1 , v2 ) ].fetch_add( 1 , std::memory_order_relaxed );
+							counts[ Entry( v2 , v1 ) ].fetch_add( 1 , std::memory_order_relaxed );
+						}
+					}
+				);
+
+			_weights.resize( neighbors.size() );
+			ThreadPool::ParallelFor( 0 , _weights.size() , [&]( size_t j ){ _weights[j] = counts[j].load( std::memory_order_relaxed ); } );
+			_version = _mesh.topologyVersion();
+		}
+
+		template< typename Real >
+		void ExplicitLaplacianIntegrator< Real >::step( std::vector< Point< Real , Dim > > & points , double stepSize , unsigned int steps )
+		{
+			if( points.size()!=_mesh.vertices.size() ) MK_THROW( "Number of points does not match number of vertices: " , points.size() , " != " , _mesh.vertices.size() );
+			const size_t * offsets = _mesh.adjacencyOffsets().data();
+			const unsigned int * neighbors = _mesh.adjacencyIndices().data();
+			if( _version!=_mesh.topologyVersion() || _weights.size()!=_mesh.adjacencyIndices().size() ) _setWeights();
+			_points.resize( points.size() );
+
+			for( unsigned int s=0 ; s<steps ; s++ )
+			{
+				const Point< Real , Dim > * in = points.data();
+				Point< Real , Dim > * out = _points.data();
+				ThreadPool::ParallelFor
+					(
+						0 , points.size() ,
+						[&]( size_t v )
+						{
+							double laplacian[Dim];
+							for( unsigned int d=0 ; d<Dim ; d++ ) laplacian[d] = 0;
+							for( size_t j=offsets[v] ; j<offsets[v+1] ; j++ )
+							{
+								const double w = _weights[j];
+								const Point< Real , Dim > & q = in[ neighbors[j] ];
+								for( unsigned int d=0 ; d<Dim ; d++ ) laplacian[d] += w * ( in[v][d] - q[d] );
+							}
+							for( unsigned int d=0 ; d<Dim ; d++ ) out[v][d] = static_cast< Real >( in[v][d] - stepSize * laplacian[d] );
+						}
+					);
+				std::swap( points , _points );
+			}
+		}
+	}
+}
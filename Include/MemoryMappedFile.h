@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <string>
+#if defined( _WIN32 ) || defined( _WIN64 )
+#include <Windows.h>
+#else // !_WIN32 && !_WIN64
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // _WIN32 || _WIN64
+#include <Misha/Exceptions.h>
+
+namespace MishaK
+{
+	namespace AdvancedGraphics
+	{
+		// A read-only view of the contents of a file, mapped into memory
+		struct MemoryMappedFile
+		{
+			// Maps the file into memory
+			// (Throws an exception if the file cannot be opened or mapped)
+			MemoryMappedFile( std::string fileName );
+			~MemoryMappedFile( void );
+
+			MemoryMappedFile( const MemoryMappedFile & ) = delete;
+			MemoryMappedFile & operator = ( const MemoryMappedFile & ) = delete;
+
+			// The start of the file contents (nullptr if the file is empty)
+			const char * data( void ) const { return _data; }
+
+			// The size of the file (in bytes)
+			size_t size( void ) const { return _size; }
+
+		protected:
+			const char * _data;
+			size_t _size;
+#if defined( _WIN32 ) || defined( _WIN64 )
+			HANDLE _file , _mapping;
+#endif // _WIN32 || _WIN64
+		};
+
+		////////////////////////////////////
+		// MemoryMappedFile (definitions) //
+		////////////////////////////////////
+#if defined( _WIN32 ) || defined( _WIN64 )
+		inline MemoryMappedFile::MemoryMappedFile( std::string fileName ) : _data(nullptr) , _size(0) , _file(INVALID_HANDLE_VALUE) , _mapping(nullptr)
+		{
+			_file = CreateFileA( fileName.c_str() , GENERIC_READ , FILE_SHARE_READ , nullptr , OPEN_EXISTING , FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN , nullptr );
+			if( _file==INVALID_HANDLE_VALUE ) MK_THROW( "Could not open file for reading: " , fileName );
+			LARGE_INTEGER fileSize;
+			if( !GetFileSizeEx( _file , &fileSize ) ) MK_THROW( "Could not get file size: " , fileName );
+			_size = static_cast< size_t >( fileSize.QuadPart );
+			if( !_size ) return;
+			_mapping = CreateFileMappingA( _file , nullptr , PAGE_READONLY , 0 , 0 , nullptr );
+			if( !_mapping ) MK_THROW( "Could not map file: " , fileName );
+			_data = static_cast< const char * >( MapViewOfFile( _mapping , FILE_MAP_READ , 0 , 0 , 0 ) );
+			if( !_data ) MK_THROW( "Could not map file: " , fileName );
+		}
+
+		inline MemoryMappedFile::~MemoryMappedFile( void )
+		{
+			if( _data ) UnmapViewOfFile( _data );
+			if( _mapping ) CloseHandle( _mapping );
+			if( _file!=INVALID_HANDLE_VALUE ) CloseHandle( _file );
+		}
+#else // !_WIN32 && !_WIN64
+		inline MemoryMappedFile::MemoryMappedFile( std::string fileName ) : _data(nullptr) , _size(0)
+		{
+			int fd = open( fileName.c_str() , O_RDONLY );
+			if( fd==-1 ) MK_THROW( "Could not open file for reading: " , fileName );
+			struct stat fileStat;
+			if( fstat( fd , &fileStat )==-1 )
+			{
+				close( fd );
+				MK_THROW( "Could not get file size: " , fileName );
+			}
+			_size = static_cast< size_t >( fileStat.st_size );
+			if( _size )
+			{
+				void * data = mmap( nullptr , _size , PROT_READ , MAP_PRIVATE , fd , 0 );
+				if( data==MAP_FAILED )
+				{
+					close( fd );
+					MK_THROW( "Could not map file: " , fileName );
+				}
+				// The file will be read in its entirety, so ask the kernel to start paging it in
+				madvise( data , _size , MADV_WILLNEED );
+				_data = static_cast< const char * >( data );
+			}
+			close( fd );
+		}
+
+		inline MemoryMappedFile::~MemoryMappedFile( void ){ if( _data ) munmap( const_cast< char * >( _data ) , _size ); }
+#endif // _WIN32 || _WIN64
+	}
+}
@@ -31,22 +31,31 @@ DAMAGE.
 #include <optional>
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <atomic>
+#include <algorithm>
+#include <charconv>
 #include <Eigen/Sparse>
 #include <Misha/MultiThreading.h>
 #include <Misha/Ply.h>
 #include <Misha/PlyVertexData.h>
 #include <Misha/Geometry.h>
 #include <Misha/Exceptions.h>
+#include <Misha/Trace.h>
+#include "RadixSort.h"
+#include "MemoryMappedFile.h"
+#include "SoAPoints.h"
 
 namespace MishaK
 {
 	namespace AdvancedGraphics
 	{
-		struct Mesh
+		// A triangle mesh whose vertex attributes are stored using the prescribed scalar type
+		// [NOTE] Quantities aggregated over the whole mesh (e.g. area) are accumulated in double precision
+		template< typename RealType >
+		struct MeshT
 		{
 			// The scalar type
-			using Real = double;
+			using Real = RealType;
 
 			// The dimension of the manifold
 			static const unsigned int K = 2;
@@ -54,6 +63,14 @@ namespace MishaK
 			// The embedding dimension of the manifold
 			static const unsigned int Dim = 3;
 
+			// The vertex orderings supported by Mesh::reorder
+			enum ReorderType
+			{
+				MORTON ,
+				REVERSE_CUTHILL_MCKEE
+			};
+			static inline const std::vector< std::string > ReorderTypeNames = { "morton" , "rcm" };
+
 			// The vertices of the mesh
 			std::vector< Point< Real , Dim > > vertices;
 
@@ -69,19 +86,27 @@ namespace MishaK
 			// The triangles the mesh
 			std::vector< SimplexIndex< K > > triangles;
 
+			// An (optional) structure-of-arrays copy of the vertex positions, for kernels that stream over the coordinates (may be zero-sized)
+			// [NOTE] Code that modifies the positions through one representation is responsible for updating the other
+			SoAPoints< Real , Dim > soaVertices;
+
 			// Default constructor
-			Mesh( void );
+			MeshT( void );
 
 			// Constructor from file
-			Mesh( std::string fileName );
+			MeshT( std::string fileName );
 
-			// Reads from file (either as .ply or .obj)
+			// The extension of the native binary format, which stores the mesh arrays (and, if set, the edges and adjacency) as they are laid out in memory
+			static inline const std::string NativeExtension = "bmesh";
+
+			// Reads from file (either as .ply, .obj, or .bmesh)
 			void read( std::string fileName );
 
-			// Writes to file (either as .ply or .obj)
+			// Writes to file (either as .ply, .obj, or .bmesh)
+			// [NOTE] When writing in the native format, the edges and adjacency are also written if they have been set
 			void write( std::string fileName ) const;
 
-			// Normalizes the mesh to have unit area
+			// Normalizes the mesh to have unit area, with the center of mass at the origin
 			void normalize( void );
 
 			// Checks that the mesh is in a reasonable state
@@ -89,13 +114,71 @@ namespace MishaK
 			void validate( void ) const;
 
 			// Returns the simplex defined by the t-th triangle
-			Simplex< double , Dim , K > simplex( unsigned int t ) const;
+			Simplex< Real , Dim , K > simplex( unsigned int t ) const;
+
+			// Copies the vertex positions into the structure-of-arrays representation
+			void setSoAVertices( void );
+
+			// Copies the positions in the structure-of-arrays representation back into the vertices
+			void updateVerticesFromSoA( void );
+
+			// Returns true if the structure-of-arrays representation has been set for the current vertices
+			bool hasSoAVertices( void ) const;
+
+			// Eigen views over the per-vertex attributes, sharing their memory
+			// -- Point attributes are viewed as (#vertices)x(Dim) row-major matrices
+			// -- A single coordinate of a point attribute is viewed as a vector with stride Dim
+			// [NOTE] The views are invalidated if the underlying arrays are resized
+			using PointMatrix = Eigen::Matrix< Real , Eigen::Dynamic , Dim , Eigen::RowMajor >;
+			using PointMap = Eigen::Map< PointMatrix , Eigen::Unaligned , Eigen::Stride< Dim , 1 > >;
+			using ConstPointMap = Eigen::Map< const PointMatrix , Eigen::Unaligned , Eigen::Stride< Dim , 1 > >;
+			using CoordinateMap = Eigen::Map< Eigen::Matrix< Real , Eigen::Dynamic , 1 > , Eigen::Unaligned , Eigen::InnerStride< Dim > >;
+			using ConstCoordinateMap = Eigen::Map< const Eigen::Matrix< Real , Eigen::Dynamic , 1 > , Eigen::Unaligned , Eigen::InnerStride< Dim > >;
+			using ValueMap = Eigen::Map< Eigen::Matrix< Real , Eigen::Dynamic , 1 > >;
+			using ConstValueMap = Eigen::Map< const Eigen::Matrix< Real , Eigen::Dynamic , 1 > >;
+
+			PointMap vertexMap( void );
+			ConstPointMap vertexMap( void ) const;
+			CoordinateMap vertexMap( unsigned int d );
+			ConstCoordinateMap vertexMap( unsigned int d ) const;
+			PointMap normalMap( void );
+			ConstPointMap normalMap( void ) const;
+			PointMap colorMap( void );
+			ConstPointMap colorMap( void ) const;
+			ValueMap valueMap( void );
+			ConstValueMap valueMap( void ) const;
+
+			// Renumbers the vertices (and triangles) to improve memory locality, either along a Morton curve or using reverse Cuthill-McKee
+			// The triangles are sorted by their smallest vertex index
+			// [NOTE] The mesh remembers the original order, so that it can be restored before writing the results
+			// [NOTE] The edge, adjacency, and structure-of-arrays information are invalidated
+			void reorder( ReorderType type );
+
+			// Restores the vertices and triangles to the order they had before Mesh::reorder was called
+			void restoreOrder( void );
+
+			// Returns the index the v-th vertex had before the mesh was reordered
+			unsigned int originalVertexIndex( unsigned int v ) const;
+
+			// Returns the bandwidth of the vertex adjacency matrix, max_{i~j} |i-j|
+			size_t bandwidth( void ) const;
+
+			// Returns the profile of the vertex adjacency matrix, \sum_i ( i - min_{j~i,j<=i} j )
+			size_t profile( void ) const;
+
+			// Marks the triangles as modified, so that edge and adjacency information computed before is treated as stale
+			// [NOTE] This should be called after modifying the triangles directly (the mesh's own methods call it when they change the triangles)
+			void topologyChanged( void );
+
+			// Returns a counter that is incremented whenever the triangles change, for clients caching connectivity information
+			size_t topologyVersion( void ) const;
 
 			// Initialize the edge information
+			// [NOTE] The edges are indexed in lexicographic order of their (sorted) end-points
 			void setEdges( void );
 
 			// Returns the number of edges
-			// [NOTE] Mesh::setEdges needs to have been called before invoking
+			// [NOTE] Mesh::setEdges needs to have been called before invoking, and after the triangles last changed
 			//        Otherwise an exception is thrown
 			size_t numEdges( void ) const;
 
@@ -114,26 +197,150 @@ namespace MishaK
 			//        Otherwise an exception is thrown
 			std::optional< unsigned int > edgeIndex( std::pair< unsigned int , unsigned int > endPoints , bool &flip ) const;
 
+			// Returns the indices of the edges of the t-th triangle, with the k-th edge opposite the k-th vertex
+			// [NOTE] Mesh::setEdges needs to have been called before invoking
+			//        Otherwise an exception is thrown
+			SimplexIndex< K > triangleEdges( unsigned int t ) const;
+
+			// Initialize the (compressed) vertex-to-vertex adjacency information
+			void setAdjacency( void );
+
+			// Returns the number of vertices adjacent to the v-th vertex
+			// [NOTE] Mesh::setAdjacency needs to have been called before invoking, and after the triangles last changed
+			//        Otherwise an exception is thrown
+			size_t valence( unsigned int v ) const;
+
+			// Returns a pointer to the (sorted) indices of the vertices adjacent to the v-th vertex
+			// [NOTE] Mesh::setAdjacency needs to have been called before invoking
+			//        Otherwise an exception is thrown
+			const unsigned int * neighbors( unsigned int v ) const;
+
+			// Returns the offsets into the adjacency indices, so that the neighbors of the v-th vertex are in the range [ offsets[v] , offsets[v+1] )
+			// [NOTE] Mesh::setAdjacency needs to have been called before invoking
+			//        Otherwise an exception is thrown
+			const std::vector< size_t > & adjacencyOffsets( void ) const;
+
+			// Returns the concatenated indices of the adjacent vertices
+			// [NOTE] Mesh::setAdjacency needs to have been called before invoking
+			//        Otherwise an exception is thrown
+			const std::vector< unsigned int > & adjacencyIndices( void ) const;
+
 		protected:
-			template< bool HasNormals , bool HasValues >
-			struct _PlyData;
+			static_assert( sizeof( Point< Real , Dim > )==sizeof( Real ) * Dim , "[ERROR] Point is not tightly packed" );
+
+			template< typename Map , typename Points >
+			static Map _PointMap( Points & points ){ return Map( points.size() ? &points[0][0] : nullptr , static_cast< Eigen::Index >( points.size() ) , Dim ); }
 
 			struct _EdgeInfo
 			{
-				struct Hasher{ size_t operator()( const std::pair< unsigned int , unsigned int > & ) const; };
-				std::unordered_map< std::pair< unsigned int , unsigned int > , unsigned int , Hasher > edgeToIndex;
+				// The edges, sorted lexicographically, with the smaller end-point first
 				std::vector< std::pair< unsigned int , unsigned int > > indexToEdge;
 
+				// The edges whose first end-point is v are in the range [ vertexOffsets[v] , vertexOffsets[v+1] )
+				std::vector< size_t > vertexOffsets;
+
+				// The indices of the edges of each triangle
+				std::vector< SimplexIndex< K > > triangleEdges;
+
+				// The topology version the edges were computed for
+				size_t version;
+
 				_EdgeInfo( void );
-				void set( const std::vector< SimplexIndex< K > > & triangles );
+				void set( size_t vNum , const std::vector< SimplexIndex< K > > & triangles );
+				std::optional< unsigned int > index( unsigned int v1 , unsigned int v2 ) const;
+			};
+
+			struct _AdjacencyInfo
+			{
+				std::vector< size_t > offsets;
+				std::vector< unsigned int > indices;
+
+				// The number of triangles and the topology version the adjacency was computed for
+				size_t triangleCount = 0 , version = 0;
+
+				void set( size_t vNum , const std::vector< SimplexIndex< K > > & triangles );
 			};
 
+			size_t _topologyVersion;
+
 			_EdgeInfo _edgeInfo;
 			bool _edgesSet;
 
-			template< bool HasNormals , bool HasValues >
-			void _write( std::string fileName ) const;
+			_AdjacencyInfo _adjacencyInfo;
+			bool _adjacencySet;
+
+			void _checkEdges( void ) const;
+			void _checkAdjacency( void ) const;
+
+			// For each (new) vertex/triangle index, the index before reordering (empty if the mesh has not been reordered)
+			std::vector< unsigned int > _vertexOrder , _triangleOrder;
+
+			// Re-indexes the vertices and triangles so that the new i-th vertex (resp. triangle) is the old vertexOrder[i]-th (resp. triangleOrder[i]-th)
+			void _permute( const std::vector< unsigned int > & vertexOrder , const std::vector< unsigned int > & triangleOrder );
+
+			// Writes the mesh as a binary PLY file, packing the vertex and face records directly from the mesh arrays
+			void _writePLY( std::string fileName ) const;
+
+			// Writes the mesh as an OBJ file, formatting the lines directly from the mesh arrays
+			void _writeOBJ( std::string fileName ) const;
+
+			// Formats the elements in [0,count) in blocks of (at most) blockSize elements, formatting blocks in parallel and writing them out in order
+			template< typename BlockFormatter /* = std::function< void ( size_t begin , size_t end , std::vector< char > & buffer ) > */ >
+			static void _WriteBlocks( std::ostream & out , size_t count , size_t blockSize , BlockFormatter formatter );
+
+			// The layout of the native file format:
+			//	A header, followed by a table describing the sections, followed by the section contents
+			//	All values are little-endian and the contents of each section are aligned to _NativeFormat::Alignment bytes
+			struct _NativeFormat
+			{
+				static const unsigned int Version = 1;
+				static const size_t Alignment = 64;
+				static inline const char Magic[8] = { 'M' , 'K' , 'M' , 'E' , 'S' , 'H' , '\0' , '\0' };
+
+				enum SectionType
+				{
+					VERTICES ,
+					NORMALS ,
+					COLORS ,
+					VALUES ,
+					TRIANGLES ,
+					EDGES ,
+					EDGE_VERTEX_OFFSETS ,
+					TRIANGLE_EDGES ,
+					ADJACENCY_OFFSETS ,
+					ADJACENCY_INDICES ,
+					SECTION_COUNT
+				};
+
+				struct Header
+				{
+					char magic[8];
+					unsigned int version , realSize , dim , k;
+					unsigned long long sectionNum;
+				};
+
+				struct Section
+				{
+					unsigned int type , elementSize;
+					unsigned long long count , offset;
+				};
+			};
+
+			void _readNative( std::string fileName );
+			void _writeNative( std::string fileName ) const;
+
+			// Reads an OBJ file, parsing contiguous ranges of lines in parallel
+			// Returns true if all the faces were triangles (and were read into triangles) and false otherwise (in which case the faces are returned as polygons)
+			bool _readOBJ( std::string fileName , std::vector< std::vector< unsigned int > > & polygons );
+
+			// Reads a binary PLY file with fixed-size vertex properties and triangular faces directly from the memory-mapped file
+			// Returns false (without reading) if the file does not have such a layout
+			bool _readMappedPLY( std::string fileName );
 		};
+
+		using Mesh = MeshT< double >;
+		using MeshF = MeshT< float >;
+
 #include "Mesh.inl"
 	}
 }
\ No newline at end of file
@@ -30,70 +30,400 @@ DAMAGE.
 // Mesh //
 //////////
 
-inline Mesh::Mesh( void ) : _edgesSet(false) {}
+template< typename RealType >
+inline MeshT< RealType >::MeshT( void ) : _topologyVersion(0) , _edgesSet(false) , _adjacencySet(false) {}
 
-inline Mesh::Mesh( std::string fileName ) : _edgesSet(false) { read(fileName); }
+template< typename RealType >
+inline MeshT< RealType >::MeshT( std::string fileName ) : _topologyVersion(0) , _edgesSet(false) , _adjacencySet(false) { read(fileName); }
 
-inline Simplex< double , Mesh::Dim , Mesh::K > Mesh::simplex( unsigned int t ) const
+template< typename RealType >
+inline Simplex< RealType , MeshT< RealType >::Dim , MeshT< RealType >::K > MeshT< RealType >::simplex( unsigned int t ) const
 {
-	Simplex< double , Dim , K > s;
+	Simplex< Real , Dim , K > s;
 	for( unsigned int k=0 ; k<=K ; k++ ) s[k] = vertices[ triangles[t][k] ];
 	return s;
 }
 
-inline void Mesh::setEdges( void )
+template< typename RealType >
+inline void MeshT< RealType >::setSoAVertices( void ){ soaVertices.set( vertices ); }
+
+template< typename RealType >
+inline void MeshT< RealType >::updateVerticesFromSoA( void ){ soaVertices.get( vertices ); }
+
+template< typename RealType >
+inline bool MeshT< RealType >::hasSoAVertices( void ) const { return vertices.size() && soaVertices.size()==vertices.size(); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::PointMap MeshT< RealType >::vertexMap( void ){ return _PointMap< PointMap >( vertices ); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::ConstPointMap MeshT< RealType >::vertexMap( void ) const { return _PointMap< ConstPointMap >( vertices ); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::CoordinateMap MeshT< RealType >::vertexMap( unsigned int d )
+{
+	if( d>=Dim ) MK_THROW( "Coordinate out of range: " , d , " >= " , Dim );
+	return CoordinateMap( vertices.size() ? &vertices[0][d] : nullptr , static_cast< Eigen::Index >( vertices.size() ) );
+}
+
+template< typename RealType >
+inline typename MeshT< RealType >::ConstCoordinateMap MeshT< RealType >::vertexMap( unsigned int d ) const
+{
+	if( d>=Dim ) MK_THROW( "Coordinate out of range: " , d , " >= " , Dim );
+	return ConstCoordinateMap( vertices.size() ? &vertices[0][d] : nullptr , static_cast< Eigen::Index >( vertices.size() ) );
+}
+
+template< typename RealType >
+inline typename MeshT< RealType >::PointMap MeshT< RealType >::normalMap( void ){ return _PointMap< PointMap >( normals ); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::ConstPointMap MeshT< RealType >::normalMap( void ) const { return _PointMap< ConstPointMap >( normals ); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::PointMap MeshT< RealType >::colorMap( void ){ return _PointMap< PointMap >( colors ); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::ConstPointMap MeshT< RealType >::colorMap( void ) const { return _PointMap< ConstPointMap >( colors ); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::ValueMap MeshT< RealType >::valueMap( void ){ return ValueMap( values.data() , static_cast< Eigen::Index >( values.size() ) ); }
+
+template< typename RealType >
+inline typename MeshT< RealType >::ConstValueMap MeshT< RealType >::valueMap( void ) const { return ConstValueMap( values.data() , static_cast< Eigen::Index >( values.size() ) ); }
+
+template< typename RealType >
+inline void MeshT< RealType >::reorder( ReorderType type )
+{
+	const size_t vNum = vertices.size();
+	std::vector< unsigned int > vertexOrder( vNum );
+
+	if( type==ReorderType::MORTON )
+	{
+		// Quantize the positions to a grid within the bounding box and sort by the interleaved bits of the grid coordinates
+		static const unsigned int Bits = 63 / Dim;
+		Point< double , Dim > bBox[2];
+		if( vNum ) bBox[0] = bBox[1] = vertices[0];
+		for( size_t i=0 ; i<vNum ; i++ ) for( unsigned int d=0 ; d<Dim ; d++ )
+			bBox[0][d] = std::min< double >( bBox[0][d] , vertices[i][d] ) , bBox[1][d] = std::max< double >( bBox[1][d] , vertices[i][d] );
+		double scale = 0;
+		for( unsigned int d=0 ; d<Dim ; d++ ) scale = std::max< double >( scale , bBox[1][d]-bBox[0][d] );
+		scale = scale>0 ? ( ( 1ull<<Bits ) - 1 ) / scale : 0;
+
+		std::vector< std::pair< unsigned long long , unsigned int > > keys( vNum );
+		ThreadPool::ParallelFor
+			(
+				0 , vNum ,
+				[&]( size_t i )
+				{
+					unsigned long long coords[Dim] , key = 0;
+					for( unsigned int d=0 ; d<Dim ; d++ ) coords[d] = static_cast< unsigned long long >( ( vertices[i][d] - bBox[0][d] ) * scale );
+					for( unsigned int b=0 ; b<Bits ; b++ ) for( unsigned int d=0 ; d<Dim ; d++ ) key |= ( ( coords[d]>>b ) & 1 )<<( b*Dim + d );
+					keys[i] = std::make_pair( key , static_cast< unsigned int >(i) );
+				}
+			);
+		RadixSort( keys , []( const std::pair< unsigned long long , unsigned int > & key ){ return key.first; } , ( 1ull<<(Bits*Dim) ) - 1 );
+		ThreadPool::ParallelFor( 0 , vNum , [&]( size_t i ){ vertexOrder[i] = keys[i].second; } );
+	}
+	else if( type==ReorderType::REVERSE_CUTHILL_MCKEE )
+	{
+		_AdjacencyInfo adjacency;
+		adjacency.set( vNum , triangles );
+		auto Valence = [&]( unsigned int v ){ return adjacency.offsets[v+1] - adjacency.offsets[v]; };
+
+		// Performs a breadth-first traversal of the seed's connected component, writing the vertices into vertexOrder starting at count and visiting the neighbors of each vertex in order of increasing valence
+		// Returns the number of levels and the lowest-valence vertex in the last level
+		// If the traversal is not committed, the vertices are left in vertexOrder (past count) but are not marked as visited
+		std::vector< unsigned int > level( vNum , static_cast< unsigned int >(-1) );
+		std::vector< unsigned int > neighbors;
+		size_t count = 0 , end = 0;
+		auto BFS = [&]( unsigned int seed , bool commit )
+			{
+				size_t start = count;
+				end = count;
+				vertexOrder[ end++ ] = seed;
+				level[seed] = 0;
+				while( start<end )
+				{
+					unsigned int v = vertexOrder[ start++ ];
+					neighbors.resize( 0 );
+					for( size_t j=adjacency.offsets[v] ; j<adjacency.offsets[v+1] ; j++ ) if( level[ adjacency.indices[j] ]==static_cast< unsigned int >(-1) )
+					{
+						level[ adjacency.indices[j] ] = level[v]+1;
+						neighbors.push_back( adjacency.indices[j] );
+					}
+					std::stable_sort( neighbors.begin() , neighbors.end() , [&]( unsigned int v1 , unsigned int v2 ){ return Valence(v1)<Valence(v2); } );
+					for( unsigned int j=0 ; j<neighbors.size() ; j++ ) vertexOrder[ end++ ] = neighbors[j];
+				}
+
+				unsigned int levels = level[ vertexOrder[end-1] ] , last = vertexOrder[end-1];
+				for( size_t i=end ; i>count && level[ vertexOrder[i-1] ]==levels ; i-- ) if( Valence( vertexOrder[i-1] )<Valence( last ) ) last = vertexOrder[i-1];
+
+				if( commit ) count = end;
+				else for( size_t i=count ; i<end ; i++ ) level[ vertexOrder[i] ] = static_cast< unsigned int >(-1);
+				return std::make_pair( levels , last );
+			};
+
+		for( unsigned int v=0 ; v<vNum ; v++ ) if( level[v]==static_cast< unsigned int >(-1) )
+		{
+			// Start from the lowest-valence vertex in the connected component
+			BFS( v , false );
+			unsigned int seed = v;
+			for( size_t i=count ; i<end ; i++ ) if( Valence( vertexOrder[i] )<Valence( seed ) ) seed = vertexOrder[i];
+
+			// Move to a pseudo-peripheral vertex, restarting from the last level while the number of levels increases
+			static const unsigned int MaxIterations = 8;
+			std::pair< unsigned int , unsigned int > levelsAndLast = BFS( seed , false );
+			for( unsigned int iter=0 ; iter<MaxIterations ; iter++ )
+			{
+				std::pair< unsigned int , unsigned int > _levelsAndLast = BFS( levelsAndLast.second , false );
+				if( _levelsAndLast.first<=levelsAndLast.first ) break;
+				seed = levelsAndLast.second , levelsAndLast = _levelsAndLast;
+			}
+			BFS( seed , true );
+		}
+		std::reverse( vertexOrder.begin() , vertexOrder.end() );
+	}
+	else MK_THROW( "Unrecognized reorder type: " , type );
+
+	// Sort the triangles by their smallest (new) vertex index
+	std::vector< unsigned int > oldToNew( vNum );
+	ThreadPool::ParallelFor( 0 , vNum , [&]( size_t i ){ oldToNew[ vertexOrder[i] ] = static_cast< unsigned int >(i); } );
+	std::vector< std::pair< unsigned int , unsigned int > > triangleKeys( triangles.size() );
+	ThreadPool::ParallelFor
+		(
+			0 , triangles.size() ,
+			[&]( size_t t )
+			{
+				unsigned int key = oldToNew[ triangles[t][0] ];
+				for( unsigned int k=1 ; k<=K ; k++ ) key = std::min< unsigned int >( key , oldToNew[ triangles[t][k] ] );
+				triangleKeys[t] = std::make_pair( key , static_cast< unsigned int >(t) );
+			}
+		);
+	RadixSort( triangleKeys , []( const std::pair< unsigned int , unsigned int > & key ){ return key.first; } , vNum ? vNum-1 : 0 );
+	std::vector< unsigned int > triangleOrder( triangles.size() );
+	ThreadPool::ParallelFor( 0 , triangles.size() , [&]( size_t t ){ triangleOrder[t] = triangleKeys[t].second; } );
+
+	_permute( vertexOrder , triangleOrder );
+
+	// Compose with any previous reordering
+	if( _vertexOrder.size() )
+	{
+		std::vector< unsigned int > _order( vNum );
+		ThreadPool::ParallelFor( 0 , vNum , [&]( size_t i ){ _order[i] = _vertexOrder[ vertexOrder[i] ]; } );
+		_vertexOrder = _order;
+		_order.resize( triangles.size() );
+		ThreadPool::ParallelFor( 0 , triangles.size() , [&]( size_t t ){ _order[t] = _triangleOrder[ triangleOrder[t] ]; } );
+		_triangleOrder = _order;
+	}
+	else _vertexOrder = vertexOrder , _triangleOrder = triangleOrder;
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::restoreOrder( void )
+{
+	if( !_vertexOrder.size() ) return;
+	if( _vertexOrder.size()!=vertices.size() || _triangleOrder.size()!=triangles.size() ) MK_THROW( "Vertex/triangle count changed since reordering" );
+
+	// Invert the permutations
+	std::vector< unsigned int > vertexOrder( _vertexOrder.size() ) , triangleOrder( _triangleOrder.size() );
+	ThreadPool::ParallelFor( 0 , vertexOrder.size() , [&]( size_t i ){ vertexOrder[ _vertexOrder[i] ] = static_cast< unsigned int >(i); } );
+	ThreadPool::ParallelFor( 0 , triangleOrder.size() , [&]( size_t t ){ triangleOrder[ _triangleOrder[t] ] = static_cast< unsigned int >(t); } );
+	_permute( vertexOrder , triangleOrder );
+	_vertexOrder.resize( 0 ) , _triangleOrder.resize( 0 );
+}
+
+template< typename RealType >
+inline unsigned int MeshT< RealType >::originalVertexIndex( unsigned int v ) const { return _vertexOrder.size() ? _vertexOrder[v] : v; }
+
+template< typename RealType >
+inline void MeshT< RealType >::_permute( const std::vector< unsigned int > & vertexOrder , const std::vector< unsigned int > & triangleOrder )
+{
+	auto Permute = [&]( auto & array )
+		{
+			if( !array.size() ) return;
+			std::remove_reference_t< decltype(array) > _array( array.size() );
+			ThreadPool::ParallelFor( 0 , array.size() , [&]( size_t i ){ _array[i] = array[ vertexOrder[i] ]; } );
+			array = std::move( _array );
+		};
+	Permute( vertices );
+	Permute( normals );
+	Permute( colors );
+	Permute( values );
+
+	std::vector< unsigned int > oldToNew( vertexOrder.size() );
+	ThreadPool::ParallelFor( 0 , vertexOrder.size() , [&]( size_t i ){ oldToNew[ vertexOrder[i] ] = static_cast< unsigned int >(i); } );
+	std::vector< SimplexIndex< K > > _triangles( triangles.size() );
+	ThreadPool::ParallelFor( 0 , triangles.size() , [&]( size_t t ){ for( unsigned int k=0 ; k<=K ; k++ ) _triangles[t][k] = oldToNew[ triangles[ triangleOrder[t] ][k] ]; } );
+	triangles = std::move( _triangles );
+
+	topologyChanged();
+	_edgesSet = _adjacencySet = false;
+	soaVertices.resize( 0 );
+}
+
+template< typename RealType >
+inline size_t MeshT< RealType >::bandwidth( void ) const
+{
+	std::atomic< size_t > bandwidth( 0 );
+	ThreadPool::ParallelFor
+		(
+			0 , triangles.size() ,
+			[&]( size_t t )
+			{
+				unsigned int vMin = triangles[t][0] , vMax = triangles[t][0];
+				for( unsigned int k=1 ; k<=K ; k++ ) vMin = std::min< unsigned int >( vMin , triangles[t][k] ) , vMax = std::max< unsigned int >( vMax , triangles[t][k] );
+				size_t b = bandwidth.load( std::memory_order_relaxed );
+				while( vMax-vMin>b && !bandwidth.compare_exchange_weak( b , vMax-vMin , std::memory_order_relaxed ) ){}
+			}
+		);
+	return bandwidth.load();
+}
+
+template< typename RealType >
+inline size_t MeshT< RealType >::profile( void ) const
 {
-	_edgeInfo.set( triangles );
+	// The smallest index of a vertex adjacent to (or equal to) each vertex
+	std::vector< std::atomic< unsigned int > > first( vertices.size() );
+	ThreadPool::ParallelFor( 0 , vertices.size() , [&]( size_t v ){ first[v].store( static_cast< unsigned int >(v) , std::memory_order_relaxed ); } );
+	ThreadPool::ParallelFor
+		(
+			0 , triangles.size() ,
+			[&]( size_t t )
+			{
+				unsigned int vMin = triangles[t][0];
+				for( unsigned int k=1 ; k<=K ; k++ ) vMin = std::min< unsigned int >( vMin , triangles[t][k] );
+				for( unsigned int k=0 ; k<=K ; k++ )
+				{
+					unsigned int f = first[ triangles[t][k] ].load( std::memory_order_relaxed );
+					while( vMin<f && !first[ triangles[t][k] ].compare_exchange_weak( f , vMin , std::memory_order_relaxed ) ){}
+				}
+			}
+		);
+	size_t profile = 0;
+	for( size_t v=0 ; v<vertices.size() ; v++ ) profile += v - first[v].load( std::memory_order_relaxed );
+	return profile;
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::topologyChanged( void ){ _topologyVersion++; }
+
+template< typename RealType >
+inline size_t MeshT< RealType >::topologyVersion( void ) const { return _topologyVersion; }
+
+template< typename RealType >
+inline void MeshT< RealType >::setEdges( void )
+{
+	_edgeInfo.set( vertices.size() , triangles );
+	_edgeInfo.version = _topologyVersion;
 	_edgesSet = true;
 }
 
-inline size_t Mesh::numEdges( void ) const
+template< typename RealType >
+inline void MeshT< RealType >::_checkEdges( void ) const
 {
 	if( !_edgesSet ) MK_THROW( "Edges not set" );
+	if( _edgeInfo.version!=_topologyVersion || _edgeInfo.triangleEdges.size()!=triangles.size() || _edgeInfo.vertexOffsets.size()!=vertices.size()+1 ) MK_THROW( "Edges are stale, the triangles have changed since Mesh::setEdges was called" );
+}
+
+template< typename RealType >
+inline size_t MeshT< RealType >::numEdges( void ) const
+{
+	_checkEdges();
 	return _edgeInfo.indexToEdge.size();
 }
 
-inline std::pair< unsigned int , unsigned int > Mesh::edge( unsigned int e ) const
+template< typename RealType >
+inline std::pair< unsigned int , unsigned int > MeshT< RealType >::edge( unsigned int e ) const
 {
-	if( !_edgesSet ) MK_THROW( "Edges not set" );
+	_checkEdges();
 	return _edgeInfo.indexToEdge[e];
 }
 
-inline std::optional< unsigned int > Mesh::edgeIndex( std::pair< unsigned int , unsigned int > endPoints ) const
+template< typename RealType >
+inline std::optional< unsigned int > MeshT< RealType >::edgeIndex( std::pair< unsigned int , unsigned int > endPoints ) const
 {
-	if( !_edgesSet ) MK_THROW( "Edges not set" );
-	auto iter = _edgeInfo.edgeToIndex.find( endPoints );
-	if( iter!=_edgeInfo.edgeToIndex.end() ) return iter->second;
-	return{};
+	_checkEdges();
+	if( endPoints.first<endPoints.second ) return _edgeInfo.index( endPoints.first , endPoints.second );
+	return {};
 }
 
-inline std::optional< unsigned int > Mesh::edgeIndex( std::pair< unsigned int , unsigned int > endPoints , bool &flip ) const
+template< typename RealType >
+inline std::optional< unsigned int > MeshT< RealType >::edgeIndex( std::pair< unsigned int , unsigned int > endPoints , bool &flip ) const
 {
-	if( !_edgesSet ) MK_THROW( "Edges not set" );
-	auto iter = _edgeInfo.edgeToIndex.find( endPoints );
-	if( iter!=_edgeInfo.edgeToIndex.end() )
-	{
-		flip = false;
-		return iter->second;
-	}
-	else
-	{
-		auto iter = _edgeInfo.edgeToIndex.find( std::make_pair( endPoints.second , endPoints.first ) );
-		if( iter!=_edgeInfo.edgeToIndex.end() )
-		{
-			flip = true;
-			return iter->second;
-		}
-	}
+	_checkEdges();
+	flip = endPoints.first>endPoints.second;
+	if( flip ) return _edgeInfo.index( endPoints.second , endPoints.first );
+	else if( endPoints.first<endPoints.second ) return _edgeInfo.index( endPoints.first , endPoints.second );
 	return {};
 }
 
-inline void Mesh::read( std::string fileName )
+template< typename RealType >
+inline SimplexIndex< MeshT< RealType >::K > MeshT< RealType >::triangleEdges( unsigned int t ) const
+{
+	_checkEdges();
+	return _edgeInfo.triangleEdges[t];
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::setAdjacency( void )
+{
+	_adjacencyInfo.set( vertices.size() , triangles );
+	_adjacencyInfo.version = _topologyVersion;
+	_adjacencySet = true;
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::_checkAdjacency( void ) const
+{
+	if( !_adjacencySet ) MK_THROW( "Adjacency not set" );
+	if( _adjacencyInfo.version!=_topologyVersion || _adjacencyInfo.triangleCount!=triangles.size() || _adjacencyInfo.offsets.size()!=vertices.size()+1 ) MK_THROW( "Adjacency is stale, the triangles have changed since Mesh::setAdjacency was called" );
+}
+
+template< typename RealType >
+inline size_t MeshT< RealType >::valence( unsigned int v ) const
+{
+	_checkAdjacency();
+	return _adjacencyInfo.offsets[v+1] - _adjacencyInfo.offsets[v];
+}
+
+template< typename RealType >
+inline const unsigned int * MeshT< RealType >::neighbors( unsigned int v ) const
+{
+	_checkAdjacency();
+	return _adjacencyInfo.indices.data() + _adjacencyInfo.offsets[v];
+}
+
+template< typename RealType >
+inline const std::vector< size_t > & MeshT< RealType >::adjacencyOffsets( void ) const
+{
+	_checkAdjacency();
+	return _adjacencyInfo.offsets;
+}
+
+template< typename RealType >
+inline const std::vector< unsigned int > & MeshT< RealType >::adjacencyIndices( void ) const
+{
+	_checkAdjacency();
+	return _adjacencyInfo.indices;
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::read( std::string fileName )
 {
+	MK_TRACE_SCOPE( "Mesh::read" );
+	topologyChanged();
+	_edgesSet = _adjacencySet = false;
+	triangles.resize( 0 );
+	soaVertices.resize( 0 );
+	_vertexOrder.resize( 0 ) , _triangleOrder.resize( 0 );
 	std::vector< std::vector< unsigned int > > polygons;
 	std::string ext = ToLower( GetFileExtension( fileName ) );
-	if( ext==std::string( "ply" ) )
+	if( ext==NativeExtension ) return _readNative( fileName );
+	else if( ext==std::string( "ply" ) )
 	{
+		// Try decoding the file directly from memory before using the generic reader
+		if( _readMappedPLY( fileName ) ) return;
+
 		using namespace VertexFactory;
 		using PLYVertexFactory = Factory< Real , PositionFactory< Real , Dim > , NormalFactory< Real , Dim > , ValueFactory< Real > , RGBColorFactory< Real > >;
 		using PLYVertex = typename PLYVertexFactory::VertexType;
@@ -126,196 +456,811 @@ inline void Mesh::read( std::string fileName )
 	}
 	else if( ext==std::string( "obj" ) )
 	{
-		std::vector< Point< Real , Dim > > obj_vertices;
-		std::vector< Point< Real , Dim > > obj_normals;
-		std::vector< Real > obj_values;
-		std::vector< std::vector< int > > obj_faces;
-		std::ifstream in( fileName );
-		if( !in.is_open() ) MK_THROW( "Could not open file for reading: " , fileName );
-
-		std::string( line );
-		while( std::getline( in , line ) )
+		// If all the faces are triangles, they are read in directly
+		if( _readOBJ( fileName , polygons ) ) return;
+	}
+	else MK_THROW( "Unrecognized file type: " , fileName , " -> " , ext );
+
+	// Triangulate the polygons using a minimal area triangulation
+	for( unsigned int i=0 ; i<polygons.size() ; i++ )
+	{
+		const std::vector< unsigned int > & polygon = polygons[i];
+		if( polygon.size()>(K+1) )
 		{
-			std::stringstream ss;
+			std::vector< Point< Real , Dim > > _vertices( polygon.size() );
+			std::vector< SimplexIndex< K > > _triangles;
+			for( unsigned int j=0 ; j<polygon.size() ; j++ ) _vertices[j] = vertices[ polygon[j] ];
+			MinimalAreaTriangulation::GetTriangulation( _vertices , _triangles );
 
-			// Read vertex position
-			if( line[0]=='v' && line[1]==' ' )
-			{
-				line = line.substr(2);
-				std::stringstream ss( line );
-				Point< Real , Dim > p;
-				for( unsigned int d=0 ; d<Dim ; d++ ) ss >> p[d];
-				obj_vertices.push_back( p );
-			}
-			// Read normal
-			else if( line[0]=='v' && line[1]=='n' && line[2]==' ' )
+			for( unsigned int j=0 ; j<_triangles.size() ; j++ ) for( unsigned int k=0 ; k<=K ; k++ ) _triangles[j][k] = polygon[ _triangles[j][k] ];
+			triangles.insert( triangles.end() , _triangles.begin() , _triangles.end() );
+		}
+		else
+		{
+			SimplexIndex< K > si;
+			for( unsigned int k=0 ; k<=K ; k++ ) si[k] = polygon[k];
+			triangles.push_back( si );
+		}
+	}
+}
+
+template< typename RealType >
+inline bool MeshT< RealType >::_readOBJ( std::string fileName , std::vector< std::vector< unsigned int > > & polygons )
+{
+	// The contents of a contiguous range of lines
+	struct Chunk
+	{
+		std::vector< Point< Real , Dim > > vertices , normals;
+		std::vector< Real > values;
+		std::vector< size_t > faceOffsets;		// The start of each face in the list of indices
+		std::vector< long long > faceIndices;	// The (zero-based) vertex indices, relative to the start of the chunk for relative indices
+		std::vector< size_t > relativeIndices;	// The positions of the relative indices in the list of indices
+		bool allTriangles = true;
+	};
+
+	static auto IsSpace = []( char c ){ return c==' ' || c=='\t' || c=='\r'; };
+
+	// Parses a number from the start of [c,end), returning the position just past it
+	auto ParseNumber = []( const char * c , const char * end , auto & value )
+		{
+			while( c<end && IsSpace(*c) ) c++;
+			if( c<end && *c=='+' ) c++;
+#if defined( __cpp_lib_to_chars ) && __cpp_lib_to_chars>=201611L
+			std::from_chars_result res = std::from_chars( c , end , value );
+			if( res.ec!=std::errc() ) MK_THROW( "Could not parse number: " , std::string( c , std::find_if( c , end , IsSpace ) ) );
+			return res.ptr;
+#else // !__cpp_lib_to_chars
+			// Older standard libraries only support integer parsing, so floating point values are copied out and parsed with strtod
+			using T = std::remove_reference_t< decltype(value) >;
+			if constexpr( std::is_integral_v< T > )
 			{
-				line = line.substr(3);
-				std::stringstream ss( line );
-				Point< Real , Dim > p;
-				for( unsigned int d=0 ; d<Dim ; d++ ) ss >> p[d];
-				obj_normals.push_back( p );
+				std::from_chars_result res = std::from_chars( c , end , value );
+				if( res.ec!=std::errc() ) MK_THROW( "Could not parse number: " , std::string( c , std::find_if( c , end , IsSpace ) ) );
+				return res.ptr;
 			}
-			// Read parameter
-			else if( line[0]=='v' && line[1]=='p' && line[2]==' ' )
+			else
 			{
-				line = line.substr(3);
-				std::stringstream ss( line );
-				Real v;
-				ss >> v;
-				obj_values.push_back( v );
+				char buffer[64];
+				size_t len = std::min< size_t >( std::find_if( c , end , [&]( char _c ){ return IsSpace(_c) || _c=='\n'; } ) - c , sizeof(buffer)-1 );
+				memcpy( buffer , c , len );
+				buffer[len] = 0;
+				char * _end;
+				value = static_cast< T >( strtod( buffer , &_end ) );
+				if( _end==buffer ) MK_THROW( "Could not parse number: " , std::string( c , c+len ) );
+				return c + ( _end - buffer );
 			}
-			// Read face
-			else if( line[0]=='f' && line[1]==' ' )
+#endif // __cpp_lib_to_chars
+		};
+
+	// Parses the lines in [c,end) into the chunk
+	auto ParseLines = [&]( const char * c , const char * end , Chunk & chunk )
+		{
+			while( c<end )
 			{
-				std::vector< int > face;
-				line = line.substr(1);
-				while( line.size() && line[0]==' ' ) line = line.substr(1);
-				std::stringstream ss( line );
-				std::string token;
-				while( std::getline( ss , token , ' ' ) )
+				const char * lineEnd = static_cast< const char * >( memchr( c , '\n' , end-c ) );
+				if( !lineEnd ) lineEnd = end;
+				while( c<lineEnd && IsSpace(*c) ) c++;
+
+				// Read vertex position
+				if( lineEnd-c>1 && c[0]=='v' && IsSpace( c[1] ) )
+				{
+					Point< Real , Dim > p;
+					c++;
+					for( unsigned int d=0 ; d<Dim ; d++ ) c = ParseNumber( c , lineEnd , p[d] );
+					chunk.vertices.push_back( p );
+				}
+				// Read normal
+				else if( lineEnd-c>2 && c[0]=='v' && c[1]=='n' && IsSpace( c[2] ) )
+				{
+					Point< Real , Dim > p;
+					c += 2;
+					for( unsigned int d=0 ; d<Dim ; d++ ) c = ParseNumber( c , lineEnd , p[d] );
+					chunk.normals.push_back( p );
+				}
+				// Read parameter
+				else if( lineEnd-c>2 && c[0]=='v' && c[1]=='p' && IsSpace( c[2] ) )
 				{
-					std::stringstream _ss(token);
-					std::string _token;
-					bool firstTime = true;
-					int idx;
-					while( std::getline( _ss , _token , '/' ) )
+					Real v;
+					ParseNumber( c+2 , lineEnd , v );
+					chunk.values.push_back( v );
+				}
+				// Read face
+				else if( lineEnd-c>1 && c[0]=='f' && IsSpace( c[1] ) )
+				{
+					size_t start = chunk.faceIndices.size();
+					chunk.faceOffsets.push_back( start );
+					c++;
+					while( true )
 					{
-						if( firstTime ) idx = std::stoi( _token );
-						firstTime = false;
+						while( c<lineEnd && IsSpace(*c) ) c++;
+						if( c==lineEnd ) break;
+
+						// Only the position index of a "v/vt/vn" token is used
+						long long idx;
+						c = ParseNumber( c , lineEnd , idx );
+						while( c<lineEnd && !IsSpace(*c) ) c++;
+
+						if( idx>0 ) chunk.faceIndices.push_back( idx-1 );
+						else if( idx<0 )
+						{
+							// Negative indices are relative to the vertices read so far
+							chunk.relativeIndices.push_back( chunk.faceIndices.size() );
+							chunk.faceIndices.push_back( static_cast< long long >( chunk.vertices.size() ) + idx );
+						}
+						else MK_THROW( "Zero-valued face index" );
 					}
-					face.push_back( idx );
+					if( chunk.faceIndices.size()-start!=K+1 ) chunk.allTriangles = false;
 				}
-				obj_faces.push_back( face );
+				c = lineEnd+1;
 			}
+		};
+
+	MemoryMappedFile file( fileName );
+	const char * data = file.data();
+	const size_t dataSize = file.size();
+
+	// Split the file into chunks that start at the beginning of a line
+	std::vector< const char * > chunkStarts;
+	{
+		const size_t MinChunkSize = 1<<20;
+		size_t chunkNum = std::max< size_t >( 1 , std::min< size_t >( 4*ThreadPool::NumThreads() , dataSize/MinChunkSize ) );
+		chunkStarts.push_back( data );
+		for( size_t i=1 ; i<chunkNum ; i++ )
+		{
+			const char * c = std::max< const char * >( data + (dataSize*i)/chunkNum , chunkStarts.back() );
+			const char * lineEnd = static_cast< const char * >( memchr( c , '\n' , data+dataSize-c ) );
+			if( !lineEnd ) break;
+			if( lineEnd+1!=chunkStarts.back() ) chunkStarts.push_back( lineEnd+1 );
 		}
-		if( obj_normals.size() && obj_normals.size()!=obj_vertices.size() ) MK_THROW( "Number of normals does not match number of vertices: " , obj_normals.size() , " != " , obj_vertices.size() );
-		if( obj_values.size() && obj_values.size()!=obj_vertices.size() ) MK_THROW( "Number of values does not match number of vertices: " , obj_values.size() , " != " , obj_vertices.size() );
+		chunkStarts.push_back( data+dataSize );
+	}
+
+	std::vector< Chunk > chunks( chunkStarts.size()-1 );
+	ThreadPool::ParallelFor( 0 , chunks.size() , [&]( size_t i ){ ParseLines( chunkStarts[i] , chunkStarts[i+1] , chunks[i] ); } , ThreadPool::NumThreads() , ThreadPool::ParallelizationType , ThreadPool::ScheduleType::DYNAMIC , 1 );
+
+	// Compute the offsets of the chunks' contents within the merged arrays
+	std::vector< size_t > vertexOffsets( chunks.size()+1 , 0 ) , normalOffsets( chunks.size()+1 , 0 ) , valueOffsets( chunks.size()+1 , 0 ) , faceOffsets( chunks.size()+1 , 0 ) , indexOffsets( chunks.size()+1 , 0 );
+	bool allTriangles = true;
+	for( unsigned int i=0 ; i<chunks.size() ; i++ )
+	{
+		vertexOffsets[i+1] = vertexOffsets[i] + chunks[i].vertices.size();
+		normalOffsets[i+1] = normalOffsets[i] + chunks[i].normals.size();
+		valueOffsets[i+1] = valueOffsets[i] + chunks[i].values.size();
+		faceOffsets[i+1] = faceOffsets[i] + chunks[i].faceOffsets.size();
+		indexOffsets[i+1] = indexOffsets[i] + chunks[i].faceIndices.size();
+		allTriangles &= chunks[i].allTriangles;
+	}
+	const size_t vNum = vertexOffsets.back();
+	if( normalOffsets.back() && normalOffsets.back()!=vNum ) MK_THROW( "Number of normals does not match number of vertices: " , normalOffsets.back() , " != " , vNum );
+	if( valueOffsets.back() && valueOffsets.back()!=vNum ) MK_THROW( "Number of values does not match number of vertices: " , valueOffsets.back() , " != " , vNum );
+
+	vertices.resize( vNum );
+	normals.resize( normalOffsets.back() );
+	values.resize( valueOffsets.back() );
+	if( allTriangles ) triangles.resize( faceOffsets.back() );
+	else polygons.resize( faceOffsets.back() );
+
+	// Merge the chunks, resolving the relative indices
+	std::atomic< bool > validIndices( true );
+	ThreadPool::ParallelFor
+		(
+			0 , chunks.size() ,
+			[&]( size_t i )
+			{
+				Chunk & chunk = chunks[i];
+				std::copy( chunk.vertices.begin() , chunk.vertices.end() , vertices.begin() + vertexOffsets[i] );
+				std::copy( chunk.normals.begin() , chunk.normals.end() , normals.begin() + normalOffsets[i] );
+				std::copy( chunk.values.begin() , chunk.values.end() , values.begin() + valueOffsets[i] );
+
+				for( unsigned int j=0 ; j<chunk.relativeIndices.size() ; j++ ) chunk.faceIndices[ chunk.relativeIndices[j] ] += vertexOffsets[i];
+				for( unsigned int j=0 ; j<chunk.faceIndices.size() ; j++ ) if( chunk.faceIndices[j]<0 || chunk.faceIndices[j]>=static_cast< long long >( vNum ) ) validIndices.store( false , std::memory_order_relaxed );
+
+				for( unsigned int j=0 ; j<chunk.faceOffsets.size() ; j++ )
+				{
+					size_t begin = chunk.faceOffsets[j] , end = j+1<chunk.faceOffsets.size() ? chunk.faceOffsets[j+1] : chunk.faceIndices.size();
+					if( allTriangles ) for( unsigned int k=0 ; k<=K ; k++ ) triangles[ faceOffsets[i]+j ][k] = static_cast< unsigned int >( chunk.faceIndices[begin+k] );
+					else
+					{
+						std::vector< unsigned int > & polygon = polygons[ faceOffsets[i]+j ];
+						polygon.resize( end-begin );
+						for( size_t k=begin ; k<end ; k++ ) polygon[k-begin] = static_cast< unsigned int >( chunk.faceIndices[k] );
+					}
+				}
+				chunk = Chunk();
+			},
+			ThreadPool::NumThreads() , ThreadPool::ParallelizationType , ThreadPool::ScheduleType::DYNAMIC , 1
+		);
+	if( !validIndices ) MK_THROW( "Face index out of range" );
 
+	return allTriangles;
+}
 
-		vertices.resize( obj_vertices.size() );
-		for( unsigned int i=0 ; i<obj_vertices.size() ; i++ ) vertices[i] = obj_vertices[i];
+template< typename RealType >
+inline bool MeshT< RealType >::_readMappedPLY( std::string fileName )
+{
+	// The decoding assumes that the in-memory representation is little-endian
+	{
+		const unsigned int one = 1;
+		if( *reinterpret_cast< const unsigned char * >( &one )!=1 ) return false;
+	}
 
-		normals.resize( obj_normals.size() );
-		for( unsigned int i=0 ; i<obj_normals.size() ; i++ ) normals[i] = obj_normals[i];
+	enum ScalarType{ INT8 , UINT8 , INT16 , UINT16 , INT32 , UINT32 , FLOAT32 , FLOAT64 , UNKNOWN };
+	auto GetScalarType = []( const std::string & name )
+		{
+			if     ( name=="char"   || name=="int8"    ) return INT8;
+			else if( name=="uchar"  || name=="uint8"   ) return UINT8;
+			else if( name=="short"  || name=="int16"   ) return INT16;
+			else if( name=="ushort" || name=="uint16"  ) return UINT16;
+			else if( name=="int"    || name=="int32"   ) return INT32;
+			else if( name=="uint"   || name=="uint32"  ) return UINT32;
+			else if( name=="float"  || name=="float32" ) return FLOAT32;
+			else if( name=="double" || name=="float64" ) return FLOAT64;
+			else                                         return UNKNOWN;
+		};
+	auto ScalarSize = []( ScalarType type ) -> size_t
+		{
+			switch( type )
+			{
+				case INT8:    case UINT8:   return 1;
+				case INT16:   case UINT16:  return 2;
+				case INT32:   case UINT32:  case FLOAT32: return 4;
+				case FLOAT64: return 8;
+				default: return 0;
+			}
+		};
 
-		values.resize( obj_values.size() );
-		for( unsigned int i=0 ; i<obj_values.size() ; i++ ) values[i] = obj_values[i];
+	struct Property
+	{
+		std::string name;
+		ScalarType type , countType;
+		size_t offset;
+		bool isList;
+	};
+	struct Element
+	{
+		std::string name;
+		size_t count , size;
+		std::vector< Property > properties;
+	};
+
+	MemoryMappedFile file( fileName );
+	const char * data = file.data();
+	const size_t dataSize = file.size();
 
-		auto ObjIndexToArrayIndex = [&]( size_t sz , int index ) -> unsigned int
+	// Parse the header
+	std::vector< Element > elements;
+	size_t pos = 0;
+	{
+		auto NextLine = [&]( std::string & line )
 			{
-				if( index>0 ) return static_cast< unsigned int >( index-1 );
-				else          return static_cast< unsigned int >( sz + index );
+				const char * end = static_cast< const char * >( memchr( data+pos , '\n' , dataSize-pos ) );
+				if( !end ) return false;
+				line = std::string( data+pos , end );
+				if( line.size() && line.back()=='\r' ) line.pop_back();
+				pos = ( end - data ) + 1;
+				return true;
 			};
 
-		polygons.resize( obj_faces.size() );
-		for( unsigned int i=0 ; i<obj_faces.size() ; i++ )
+		std::string line;
+		if( !dataSize || !NextLine( line ) || line!="ply" ) return false;
+		bool binaryLittleEndian = false , endHeader = false;
+		while( !endHeader && NextLine( line ) )
 		{
-			std::vector< unsigned int > & polygon = polygons[i];
-			polygon.resize( obj_faces[i].size() );
-			for( unsigned int j=0 ; j<obj_faces[i].size() ; j++ ) polygon[j] = ObjIndexToArrayIndex( obj_vertices.size() , obj_faces[i][j] );
+			std::stringstream ss( line );
+			std::string keyword;
+			ss >> keyword;
+			if( keyword=="format" )
+			{
+				std::string format;
+				ss >> format;
+				binaryLittleEndian = format=="binary_little_endian";
+			}
+			else if( keyword=="element" )
+			{
+				Element element;
+				if( !( ss >> element.name >> element.count ) ) return false;
+				element.size = 0;
+				elements.push_back( element );
+			}
+			else if( keyword=="property" )
+			{
+				if( !elements.size() ) return false;
+				Element & element = elements.back();
+				Property property;
+				std::string type;
+				ss >> type;
+				property.isList = type=="list";
+				if( property.isList )
+				{
+					std::string countType , indexType;
+					ss >> countType >> indexType;
+					property.countType = GetScalarType( countType );
+					property.type = GetScalarType( indexType );
+				}
+				else property.countType = UNKNOWN , property.type = GetScalarType( type );
+				ss >> property.name;
+				if( property.type==UNKNOWN || ( property.isList && property.countType==UNKNOWN ) ) return false;
+				property.offset = element.size;
+				if( !property.isList ) element.size += ScalarSize( property.type );
+				element.properties.push_back( property );
+			}
+			else if( keyword=="end_header" ) endHeader = true;
 		}
+		if( !endHeader || !binaryLittleEndian ) return false;
 	}
-	else MK_THROW( "Unrecognized file type: " , fileName , " -> " , ext );
 
-	// Triangulate the polygons using a minimal area triangulation
-	for( unsigned int i=0 ; i<polygons.size() ; i++ )
+	// Locate the vertex and face data, requiring that all the data preceding it have fixed size
+	const Element * vElement = nullptr , * fElement = nullptr;
+	const char * vData = nullptr , * fData = nullptr;
+	size_t faceSize = 0;
+	for( unsigned int e=0 ; e<elements.size() && !( vElement && fElement ) ; e++ )
 	{
-		const std::vector< unsigned int > & polygon = polygons[i];
-		if( polygon.size()>(K+1) )
+		const Element & element = elements[e];
+		size_t elementSize = element.size;
+		if( element.name=="vertex" )
 		{
-			std::vector< Point< Real , Dim > > _vertices( polygon.size() );
-			std::vector< SimplexIndex< K > > _triangles;
-			for( unsigned int j=0 ; j<polygon.size() ; j++ ) _vertices[j] = vertices[ polygon[j] ];
-			MinimalAreaTriangulation::GetTriangulation( _vertices , _triangles );
-
-			for( unsigned int j=0 ; j<_triangles.size() ; j++ ) for( unsigned int k=0 ; k<=K ; k++ ) _triangles[j][k] = polygon[ _triangles[j][k] ];
-			triangles.insert( triangles.end() , _triangles.begin() , triangles.end() );
+			for( unsigned int p=0 ; p<element.properties.size() ; p++ ) if( element.properties[p].isList ) return false;
+			vElement = &element , vData = data + pos;
 		}
-		else
+		else if( element.name=="face" )
 		{
-			SimplexIndex< K > si;
-			for( unsigned int k=0 ; k<=K ; k++ ) si[k] = polygon[k];
-			triangles.push_back( si );
+			// Assume that the faces are triangles with only a list of 32-bit indices (this will be validated below)
+			if( element.properties.size()!=1 || !element.properties[0].isList || ScalarSize( element.properties[0].type )!=4 ) return false;
+			if( element.properties[0].name!="vertex_indices" && element.properties[0].name!="vertex_index" ) return false;
+			if( element.properties[0].countType==FLOAT32 || element.properties[0].countType==FLOAT64 ) return false;
+			faceSize = elementSize = ScalarSize( element.properties[0].countType ) + 3 * sizeof( unsigned int );
+			fElement = &element , fData = data + pos;
 		}
+		else for( unsigned int p=0 ; p<element.properties.size() ; p++ ) if( element.properties[p].isList ) return false;
+
+		if( element.count && elementSize>( dataSize-pos )/element.count ) return false;
+		pos += element.count * elementSize;
+	}
+	if( !vElement || !fElement ) return false;
+
+	const size_t vNum = vElement->count , fNum = fElement->count;
+
+	// Confirm that all the faces are triangles
+	{
+		const ScalarType countType = fElement->properties[0].countType;
+		std::atomic< bool > allTriangles( true );
+		ThreadPool::ParallelFor
+			(
+				0 , fNum ,
+				[&]( size_t f )
+				{
+					const char * c = fData + f*faceSize;
+					unsigned long long count = 0;
+					switch( ScalarSize( countType ) )
+					{
+						case 1: count = static_cast< unsigned char >( *c ) ; break;
+						case 2: { unsigned short _count ; memcpy( &_count , c , sizeof(_count) ) ; count = _count ; break; }
+						case 4: { unsigned int   _count ; memcpy( &_count , c , sizeof(_count) ) ; count = _count ; break; }
+					}
+					if( count!=K+1 ) allTriangles.store( false , std::memory_order_relaxed );
+				}
+			);
+		if( !allTriangles ) return false;
 	}
+
+	// Get the layout of the vertex attributes
+	auto FindProperty = [&]( std::initializer_list< const char * > names ) -> const Property *
+		{
+			for( const char * name : names ) for( unsigned int p=0 ; p<vElement->properties.size() ; p++ ) if( vElement->properties[p].name==name ) return &vElement->properties[p];
+			return nullptr;
+		};
+	const Property * position[] = { FindProperty( { "x" } ) , FindProperty( { "y" } ) , FindProperty( { "z" } ) };
+	const Property * normal[] = { FindProperty( { "nx" } ) , FindProperty( { "ny" } ) , FindProperty( { "nz" } ) };
+	const Property * color[] = { FindProperty( { "red" , "r" } ) , FindProperty( { "green" , "g" } ) , FindProperty( { "blue" , "b" } ) };
+	const Property * value = FindProperty( { "value" } );
+	if( !position[0] || !position[1] || !position[2] ) MK_THROW( "Vertices do not have positions" );
+	const bool hasNormals = normal[0] && normal[1] && normal[2];
+	const bool hasColors = color[0] && color[1] && color[2];
+
+	// Converts the values of the property into a strided array
+	auto ReadProperty = [&]( const Property & property , Real * out , size_t stride )
+		{
+			const char * in = vData + property.offset;
+			const size_t inStride = vElement->size;
+			auto Convert = [&]( auto t )
+				{
+					using T = decltype(t);
+					ThreadPool::ParallelFor( 0 , vNum , [&]( size_t i ){ T v ; memcpy( &v , in + i*inStride , sizeof(T) ) ; out[i*stride] = static_cast< Real >( v ); } );
+				};
+			switch( property.type )
+			{
+				case INT8:    Convert( (  signed  char)0 ) ; break;
+				case UINT8:   Convert( (unsigned  char)0 ) ; break;
+				case INT16:   Convert(         short(0) ) ; break;
+				case UINT16:  Convert( (unsigned short)0 ) ; break;
+				case INT32:   Convert(           int(0) ) ; break;
+				case UINT32:  Convert( (unsigned   int)0 ) ; break;
+				case FLOAT32: Convert(         float(0) ) ; break;
+				case FLOAT64: Convert(        double(0) ) ; break;
+				default: MK_THROW( "Unrecognized type" );
+			}
+		};
+
+	static_assert( sizeof( Point< Real , Dim > )==sizeof( Real ) * Dim , "[ERROR] Point is not tightly packed" );
+	static_assert( sizeof( SimplexIndex< K > )==sizeof( unsigned int ) * (K+1) , "[ERROR] SimplexIndex is not tightly packed" );
+
+	vertices.resize( vNum );
+	normals.resize( hasNormals ? vNum : 0 );
+	values.resize( value ? vNum : 0 );
+	colors.resize( hasColors ? vNum : 0 );
+	if( vNum )
+	{
+		for( unsigned int d=0 ; d<Dim ; d++ ) ReadProperty( *position[d] , &vertices[0][d] , Dim );
+		if( hasNormals ) for( unsigned int d=0 ; d<Dim ; d++ ) ReadProperty( *normal[d] , &normals[0][d] , Dim );
+		if( hasColors ) for( unsigned int d=0 ; d<Dim ; d++ ) ReadProperty( *color[d] , &colors[0][d] , Dim );
+		if( value ) ReadProperty( *value , &values[0] , 1 );
+	}
+
+	// Copy the triangle indices, skipping over the (per-face) count
+	triangles.resize( fNum );
+	const size_t countSize = ScalarSize( fElement->properties[0].countType );
+	ThreadPool::ParallelFor( 0 , fNum , [&]( size_t f ){ memcpy( &triangles[f] , fData + f*faceSize + countSize , sizeof( SimplexIndex< K > ) ); } );
+
+	return true;
 }
 
-inline void Mesh::write( std::string fileName ) const
+template< typename RealType >
+inline void MeshT< RealType >::_readNative( std::string fileName )
 {
-	if     ( normals.size() && values.size() ) _write< true  , true  >( fileName );
-	else if( normals.size() )                  _write< true  , false >( fileName );
-	else if(                   values.size() ) _write< false , true  >( fileName );
-	else                                       _write< false , false >( fileName );
-}
+	using Format = _NativeFormat;
+	using Header = typename Format::Header;
+	using Section = typename Format::Section;
+	static_assert( sizeof( Header )==32 && sizeof( Section )==24 , "[ERROR] Unexpected native header layout" );
+	static_assert( sizeof( Point< Real , Dim > )==sizeof( Real ) * Dim , "[ERROR] Point is not tightly packed" );
+	static_assert( sizeof( SimplexIndex< K > )==sizeof( unsigned int ) * (K+1) , "[ERROR] SimplexIndex is not tightly packed" );
+	{
+		const unsigned int one = 1;
+		if( *reinterpret_cast< const unsigned char * >( &one )!=1 ) MK_THROW( "Native format is only supported on little-endian machines" );
+	}
 
+	MemoryMappedFile file( fileName );
+	const char * data = file.data();
 
-template< bool HasNormals , bool HasValues >
-void Mesh::_write( std::string fileName ) const
-{
-	std::string ext = ToLower( GetFileExtension( fileName ) );
-	if( ext==std::string( "ply" ) )
+	Header header;
+	if( file.size()<sizeof( Header ) ) MK_THROW( "File too small for header: " , fileName );
+	memcpy( &header , data , sizeof( Header ) );
+	if( memcmp( header.magic , Format::Magic , sizeof( Format::Magic ) ) ) MK_THROW( "Not a native mesh file: " , fileName );
+	if( header.version!=Format::Version ) MK_THROW( "Unsupported native mesh version: " , header.version , " != " , Format::Version );
+	if( header.realSize!=sizeof( Real ) || header.dim!=Dim || header.k!=K ) MK_THROW( "Native mesh type does not match: " , header.realSize , " / " , header.dim , " / " , header.k );
+	if( header.sectionNum>( file.size()-sizeof( Header ) ) / sizeof( Section ) ) MK_THROW( "File too small for section table: " , fileName );
+
+	// Get the (bounds-checked) sections
+	std::vector< const Section * > sections( Format::SECTION_COUNT , nullptr );
+	std::vector< Section > _sections( header.sectionNum );
+	memcpy( _sections.data() , data + sizeof( Header ) , sizeof( Section ) * header.sectionNum );
+	for( unsigned int i=0 ; i<_sections.size() ; i++ )
 	{
-		using PlyData = _PlyData< HasNormals , HasValues >;
-		using VertexFactory = typename PlyData::Factory;
-		using Vertex = typename PlyData::Vertex;
+		const Section & section = _sections[i];
+		if( section.offset>file.size() || ( section.elementSize && section.count>( file.size()-section.offset ) / section.elementSize ) ) MK_THROW( "Section extends past end of file: " , section.type );
+		// Unrecognized sections are skipped
+		if( section.type<Format::SECTION_COUNT ) sections[ section.type ] = &section;
+	}
+
+	// Copies the section contents into the array, checking that the element sizes match
+	auto ReadSection = [&]( typename Format::SectionType type , auto & array )
+		{
+			using Data = typename std::remove_reference_t< decltype(array) >::value_type;
+			const Section * section = sections[type];
+			if( !section ){ array.resize( 0 ) ; return false; }
+			if( section->elementSize!=sizeof( Data ) ) MK_THROW( "Element size does not match: " , section->elementSize , " != " , sizeof( Data ) );
+			array.resize( section->count );
+
+			// Copy in blocks so that large sections are copied in parallel
+			const size_t BlockSize = 1<<20;
+			const size_t size = sizeof( Data ) * section->count;
+			const char * in = data + section->offset;
+			char * out = reinterpret_cast< char * >( array.data() );
+			ThreadPool::ParallelFor( 0 , ( size + BlockSize - 1 ) / BlockSize , [&]( size_t b ){ memcpy( out + b*BlockSize , in + b*BlockSize , std::min< size_t >( BlockSize , size - b*BlockSize ) ); } );
+			return true;
+		};
 
-		VertexFactory factory;
+	if( !ReadSection( Format::VERTICES , vertices ) ) MK_THROW( "Vertices do not have positions" );
+	ReadSection( Format::NORMALS , normals );
+	ReadSection( Format::COLORS , colors );
+	ReadSection( Format::VALUES , values );
+	ReadSection( Format::TRIANGLES , triangles );
 
-		std::vector< Vertex > plyVertices( vertices.size() );
-		for( unsigned int i=0 ; i<vertices.size() ; i++ )
+	_edgesSet = ReadSection( Format::EDGES , _edgeInfo.indexToEdge );
+	_edgesSet &= ReadSection( Format::EDGE_VERTEX_OFFSETS , _edgeInfo.vertexOffsets );
+	_edgesSet &= ReadSection( Format::TRIANGLE_EDGES , _edgeInfo.triangleEdges );
+	if( _edgesSet && ( _edgeInfo.vertexOffsets.size()!=vertices.size()+1 || _edgeInfo.triangleEdges.size()!=triangles.size() ) ) MK_THROW( "Edge sections do not match the mesh" );
+	_edgeInfo.version = _topologyVersion;
+
+	_adjacencySet = ReadSection( Format::ADJACENCY_OFFSETS , _adjacencyInfo.offsets );
+	_adjacencySet &= ReadSection( Format::ADJACENCY_INDICES , _adjacencyInfo.indices );
+	if( _adjacencySet && _adjacencyInfo.offsets.size()!=vertices.size()+1 ) MK_THROW( "Adjacency sections do not match the mesh" );
+	_adjacencyInfo.triangleCount = triangles.size() , _adjacencyInfo.version = _topologyVersion;
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::_writeNative( std::string fileName ) const
+{
+	using Format = _NativeFormat;
+	using Header = typename Format::Header;
+	using Section = typename Format::Section;
+	{
+		const unsigned int one = 1;
+		if( *reinterpret_cast< const unsigned char * >( &one )!=1 ) MK_THROW( "Native format is only supported on little-endian machines" );
+	}
+
+	// The (non-empty) sections and their contents
+	std::vector< Section > sections;
+	std::vector< const void * > contents;
+	auto AddSection = [&]( typename Format::SectionType type , const auto & array )
 		{
-			PlyData::SetPosition( plyVertices[i] , vertices[i] );
-			if constexpr( HasNormals ) PlyData::SetNormal( plyVertices[i] , normals[i] );
-			if constexpr( HasValues ) PlyData::SetValue( plyVertices[i] , values[i] );
-		}
+			using Data = typename std::remove_reference_t< decltype(array) >::value_type;
+			if( !array.size() ) return;
+			Section section;
+			section.type = type;
+			section.elementSize = sizeof( Data );
+			section.count = array.size();
+			section.offset = 0;
+			sections.push_back( section );
+			contents.push_back( array.data() );
+		};
+	AddSection( Format::VERTICES , vertices );
+	AddSection( Format::NORMALS , normals );
+	AddSection( Format::COLORS , colors );
+	AddSection( Format::VALUES , values );
+	AddSection( Format::TRIANGLES , triangles );
+	if( _edgesSet && _edgeInfo.vertexOffsets.size()==vertices.size()+1 )
+	{
+		AddSection( Format::EDGES , _edgeInfo.indexToEdge );
+		AddSection( Format::EDGE_VERTEX_OFFSETS , _edgeInfo.vertexOffsets );
+		AddSection( Format::TRIANGLE_EDGES , _edgeInfo.triangleEdges );
+	}
+	if( _adjacencySet && _adjacencyInfo.offsets.size()==vertices.size()+1 )
+	{
+		AddSection( Format::ADJACENCY_OFFSETS , _adjacencyInfo.offsets );
+		AddSection( Format::ADJACENCY_INDICES , _adjacencyInfo.indices );
+	}
 
-		PLY::WriteSimplices( fileName , factory , plyVertices , triangles , PLY_BINARY_NATIVE  );
+	// Lay out the sections
+	auto Align = []( unsigned long long offset ){ return ( ( offset + Format::Alignment - 1 ) / Format::Alignment ) * Format::Alignment; };
+	unsigned long long offset = sizeof( Header ) + sizeof( Section ) * sections.size();
+	for( unsigned int i=0 ; i<sections.size() ; i++ )
+	{
+		sections[i].offset = offset = Align( offset );
+		offset += sections[i].count * sections[i].elementSize;
 	}
-	else if( ext==std::string( "obj" ) )
+
+	Header header;
+	memcpy( header.magic , Format::Magic , sizeof( Format::Magic ) );
+	header.version = Format::Version;
+	header.realSize = sizeof( Real );
+	header.dim = Dim;
+	header.k = K;
+	header.sectionNum = sections.size();
+
+	std::ofstream out( fileName , std::ios::binary );
+	if( !out.is_open() ) MK_THROW( "Could not open file for writing: " , fileName );
+	out.write( reinterpret_cast< const char * >( &header ) , sizeof( Header ) );
+	out.write( reinterpret_cast< const char * >( sections.data() ) , sizeof( Section ) * sections.size() );
+	const char padding[ Format::Alignment ] = {};
+	offset = sizeof( Header ) + sizeof( Section ) * sections.size();
+	for( unsigned int i=0 ; i<sections.size() ; i++ )
 	{
-		std::ofstream out( fileName );
-		if( !out.is_open() ) MK_THROW( "Could not open file for writing: " , fileName );
+		out.write( padding , sections[i].offset - offset );
+		out.write( static_cast< const char * >( contents[i] ) , sections[i].count * sections[i].elementSize );
+		offset = sections[i].offset + sections[i].count * sections[i].elementSize;
+	}
+	if( !out ) MK_THROW( "Failed to write: " , fileName );
+}
 
-		for( size_t i=0 ; i<vertices.size() ; i++ )
+template< typename RealType >
+inline void MeshT< RealType >::write( std::string fileName ) const
+{
+	MK_TRACE_SCOPE( "Mesh::write" );
+	std::string ext = ToLower( GetFileExtension( fileName ) );
+	if     ( ext==NativeExtension ) _writeNative( fileName );
+	else if( ext==std::string( "ply" ) ) _writePLY( fileName );
+	else if( ext==std::string( "obj" ) ) _writeOBJ( fileName );
+	else MK_THROW( "Unrecognized file type: " , fileName , " -> " , ext );
+}
+
+template< typename RealType >
+template< typename BlockFormatter >
+void MeshT< RealType >::_WriteBlocks( std::ostream & out , size_t count , size_t blockSize , BlockFormatter formatter )
+{
+	// Process the blocks in batches, with one buffer per block in the batch, so that memory use is bounded
+	const size_t blocks = ( count + blockSize - 1 ) / blockSize;
+	const size_t batchSize = std::max< size_t >( 1 , ThreadPool::NumThreads() );
+	std::vector< std::vector< char > > buffers( std::min< size_t >( blocks , batchSize ) );
+	for( size_t batchStart=0 ; batchStart<blocks ; batchStart+=batchSize )
+	{
+		const size_t batchEnd = std::min< size_t >( blocks , batchStart+batchSize );
+		ThreadPool::ParallelFor
+			(
+				batchStart , batchEnd ,
+				[&]( size_t b )
+				{
+					std::vector< char > & buffer = buffers[ b-batchStart ];
+					buffer.resize( 0 );
+					formatter( b*blockSize , std::min< size_t >( count , (b+1)*blockSize ) , buffer );
+				} ,
+				ThreadPool::NumThreads() , ThreadPool::ParallelizationType , ThreadPool::ScheduleType::DYNAMIC , 1
+			);
+		for( size_t b=batchStart ; b<batchEnd ; b++ ) out.write( buffers[ b-batchStart ].data() , buffers[ b-batchStart ].size() );
+	}
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::_writePLY( std::string fileName ) const
+{
+	static const size_t BlockSize = 1<<16;
+	static_assert( std::is_same_v< Real , float > || std::is_same_v< Real , double > , "[ERROR] Unsupported scalar type" );
+
+	const bool hasNormals = normals.size()==vertices.size() && normals.size();
+	const bool hasValues = values.size()==vertices.size() && values.size();
+	const bool hasColors = colors.size()==vertices.size() && colors.size();
+
+	std::ofstream out( fileName , std::ios::binary );
+	if( !out.is_open() ) MK_THROW( "Could not open file for writing: " , fileName );
+
+	// Write the header, with the data in the native byte order
+	{
+		const unsigned int one = 1;
+		const bool littleEndian = *reinterpret_cast< const unsigned char * >( &one )==1;
+		const std::string realName = std::is_same_v< Real , float > ? "float" : "double";
+		std::stringstream header;
+		header << "ply" << "\n";
+		header << "format " << ( littleEndian ? "binary_little_endian" : "binary_big_endian" ) << " 1.0" << "\n";
+		header << "element vertex " << vertices.size() << "\n";
+		header << "property " << realName << " x" << "\n";
+		header << "property " << realName << " y" << "\n";
+		header << "property " << realName << " z" << "\n";
+		if( hasNormals )
 		{
-			out << "v";
-			for( unsigned int d=0 ; d<Dim ; d++ ) out << " " << vertices[i][d];
-			out << std::endl;
+			header << "property " << realName << " nx" << "\n";
+			header << "property " << realName << " ny" << "\n";
+			header << "property " << realName << " nz" << "\n";
 		}
-
-		if constexpr( HasNormals )
+		if( hasValues ) header << "property " << realName << " value" << "\n";
+		if( hasColors )
 		{
-			for( size_t i=0 ; i<normals.size() ; i++ )
+			header << "property uchar red" << "\n";
+			header << "property uchar green" << "\n";
+			header << "property uchar blue" << "\n";
+		}
+		header << "element face " << triangles.size() << "\n";
+		header << "property list uchar int vertex_indices" << "\n";
+		header << "end_header" << "\n";
+		out << header.str();
+	}
+
+	// Pack the vertex records
+	const size_t vertexSize = sizeof( Real ) * ( Dim + ( hasNormals ? Dim : 0 ) + ( hasValues ? 1 : 0 ) ) + ( hasColors ? Dim : 0 );
+	_WriteBlocks
+		(
+			out , vertices.size() , BlockSize ,
+			[&]( size_t begin , size_t end , std::vector< char > & buffer )
 			{
-				out << "vt";
-				for( unsigned int d=0 ; d<Dim ; d++ ) out << " " << normals[i][d];
-				out << std::endl;
+				buffer.resize( ( end-begin ) * vertexSize );
+				char * c = buffer.data();
+				for( size_t i=begin ; i<end ; i++ )
+				{
+					memcpy( c , &vertices[i][0] , sizeof( Real ) * Dim ) , c += sizeof( Real ) * Dim;
+					if( hasNormals ) memcpy( c , &normals[i][0] , sizeof( Real ) * Dim ) , c += sizeof( Real ) * Dim;
+					if( hasValues ) memcpy( c , &values[i] , sizeof( Real ) ) , c += sizeof( Real );
+					if( hasColors ) for( unsigned int d=0 ; d<Dim ; d++ ) *c++ = static_cast< char >( static_cast< unsigned char >( std::max< double >( 0 , std::min< double >( 255 , colors[i][d]+0.5 ) ) ) );
+				}
 			}
-		}
+		);
 
-		if constexpr( HasValues )
-		{
-			for( size_t i=0 ; i<values.size() ; i++ )
+	// Pack the face records
+	static_assert( sizeof( SimplexIndex< K > )==sizeof( unsigned int ) * (K+1) , "[ERROR] SimplexIndex is not tightly packed" );
+	const size_t faceSize = 1 + sizeof( SimplexIndex< K > );
+	_WriteBlocks
+		(
+			out , triangles.size() , BlockSize ,
+			[&]( size_t begin , size_t end , std::vector< char > & buffer )
 			{
-				out << "vp";
-				out << " " << values[i];
-				out << std::endl;
+				buffer.resize( ( end-begin ) * faceSize );
+				char * c = buffer.data();
+				for( size_t t=begin ; t<end ; t++ )
+				{
+					*c++ = static_cast< char >( K+1 );
+					memcpy( c , &triangles[t] , sizeof( SimplexIndex< K > ) ) , c += sizeof( SimplexIndex< K > );
+				}
 			}
-		}
+		);
+	if( !out ) MK_THROW( "Failed to write: " , fileName );
+}
 
+template< typename RealType >
+inline void MeshT< RealType >::_writeOBJ( std::string fileName ) const
+{
+	static const size_t BlockSize = 1<<14;
+	// An upper bound on the number of characters needed to represent a scalar/index
+	static const size_t MaxRealChars = 32 , MaxIndexChars = 12;
 
-		for( size_t i=0 ; i<triangles.size() ; i++ )
+	// Appends the value (preceded by a space) to the buffer, assuming that there is sufficient capacity
+	auto Append = []( char * & c , auto value )
 		{
-			out << "f";
-			for( unsigned int k=0 ; k<=K ; k++ ) out << " " << ( triangles[i][k]+1);
-			out << std::endl;
-		}
-	}
-	else MK_THROW( "Unrecognized file type: " , fileName , " -> " , ext );
+			*c++ = ' ';
+#if defined( __cpp_lib_to_chars ) && __cpp_lib_to_chars>=201611L
+			c = std::to_chars( c , c+MaxRealChars , value ).ptr;
+#else // !__cpp_lib_to_chars
+			// Older standard libraries only support integer formatting, so floating point values are formatted with snprintf
+			if constexpr( std::is_integral_v< decltype(value) > ) c = std::to_chars( c , c+MaxRealChars , value ).ptr;
+			else c += snprintf( c , MaxRealChars , "%.*g" , std::numeric_limits< decltype(value) >::max_digits10 , value );
+#endif // __cpp_lib_to_chars
+		};
+
+	// Formats the lines for the elements in [begin,end), with each line containing a tag followed by the (at most) maxChars long output of the line formatter
+	auto Lines = [&]( const char * tag , size_t maxChars , auto LineFormatter )
+		{
+			return [&,tag,maxChars,LineFormatter]( size_t begin , size_t end , std::vector< char > & buffer )
+				{
+					const size_t tagSize = strlen( tag );
+					buffer.resize( ( end-begin ) * ( tagSize + maxChars + 1 ) );
+					char * c = buffer.data();
+					for( size_t i=begin ; i<end ; i++ )
+					{
+						memcpy( c , tag , tagSize ) , c += tagSize;
+						LineFormatter( c , i );
+						*c++ = '\n';
+					}
+					buffer.resize( c - buffer.data() );
+				};
+		};
+
+	std::ofstream out( fileName , std::ios::binary );
+	if( !out.is_open() ) MK_THROW( "Could not open file for writing: " , fileName );
+
+	auto FormatPoint = [&]( char * & c , const Point< Real , Dim > & p ){ for( unsigned int d=0 ; d<Dim ; d++ ) Append( c , p[d] ); };
+
+	_WriteBlocks( out , vertices.size() , BlockSize , Lines( "v" , Dim*(MaxRealChars+1) , [&]( char * & c , size_t i ){ FormatPoint( c , vertices[i] ); } ) );
+	if( normals.size() ) _WriteBlocks( out , normals.size() , BlockSize , Lines( "vn" , Dim*(MaxRealChars+1) , [&]( char * & c , size_t i ){ FormatPoint( c , normals[i] ); } ) );
+	if( values.size() ) _WriteBlocks( out , values.size() , BlockSize , Lines( "vp" , MaxRealChars+1 , [&]( char * & c , size_t i ){ Append( c , values[i] ); } ) );
+	_WriteBlocks
+		(
+			out , triangles.size() , BlockSize ,
+			Lines( "f" , (K+1)*(MaxIndexChars+1) , [&]( char * & c , size_t t ){ for( unsigned int k=0 ; k<=K ; k++ ) Append( c , triangles[t][k]+1 ); } )
+		);
+	if( !out ) MK_THROW( "Failed to write: " , fileName );
 }
 
-inline void Mesh::validate( void ) const
+template< typename RealType >
+inline void MeshT< RealType >::normalize( void )
+{
+	// Accumulate the area-weighted center of mass (in the first Dim coordinates) and the area (in the last coordinate) in double precision
+	// [NOTE] The reduction is deterministic, so the normalized mesh does not depend on the number of threads
+	Point< double , Dim+1 > moments = ThreadPool::ParallelReduce
+		(
+			0 , triangles.size() ,
+			[&]( size_t t )
+			{
+				Simplex< double , Dim , K > s;
+				for( unsigned int k=0 ; k<=K ; k++ ) s[k] = vertices[ triangles[t][k] ];
+				double a = s.measure();
+				Point< double , Dim > c = s.center() * a;
+				Point< double , Dim+1 > m;
+				for( unsigned int d=0 ; d<Dim ; d++ ) m[d] = c[d];
+				m[Dim] = a;
+				return m;
+			} ,
+			Point< double , Dim+1 >() ,
+			[]( const Point< double , Dim+1 > & m1 , const Point< double , Dim+1 > & m2 ){ return m1 + m2; }
+		);
+
+	Point< double , Dim > center;
+	const double area = moments[Dim];
+	for( unsigned int d=0 ; d<Dim ; d++ ) center[d] = moments[d];
+	if( area<=0 ) MK_THROW( "Mesh has no area" );
+	center /= area;
+
+	const double scale = 1. / sqrt( area );
+	ThreadPool::ParallelFor( 0 , vertices.size() , [&]( size_t v ){ vertices[v] = Point< Real , Dim >( ( Point< double , Dim >( vertices[v] ) - center ) * scale ); } );
+}
+
+template< typename RealType >
+inline void MeshT< RealType >::validate( void ) const
 {
 	if( normals.size() && normals.size()!=vertices.size() ) MK_THROW( "Normal count does not match vertex count: " , normals.size() , " != " , vertices.size() );
 	if( values.size() && values.size()!=vertices.size() ) MK_THROW( "Value count does not match vertex count: " , values.size() , " != " , vertices.size() );
@@ -324,69 +1269,132 @@ inline void Mesh::validate( void ) const
 
 }
 
-//////////////////////////////////////
-// Mesh::_PlyData (specializations) //
-//////////////////////////////////////
-
-template<>
-struct Mesh::_PlyData< true , true >
-{
-	using Factory = VertexFactory::Factory< Real , VertexFactory::PositionFactory< Real , Dim > , VertexFactory::NormalFactory< Real , Dim > , VertexFactory::ValueFactory< Real > >;
-	using Vertex = typename Factory::VertexType;
-	static void SetPosition( Vertex & vertex , Point< Real , Dim > p ){ vertex.template get<0>() = p; }
-	static void SetNormal( Vertex & vertex , Point< Real , Dim > n ){ vertex.template get<1>() = n; }
-	static void SetValue( Vertex & vertex , Real v ){ vertex.template get<2>() = v; }
-};
-template<>
-struct Mesh::_PlyData< true , false >
-{
-	using Factory = VertexFactory::Factory< Real , VertexFactory::PositionFactory< Real , Dim > , VertexFactory::NormalFactory< Real , Dim > >;
-	using Vertex = typename Factory::VertexType;
-	static void SetPosition( Vertex & vertex , Point< Real , Dim > p ){ vertex.template get<0>() = p; }
-	static void SetNormal( Vertex & vertex , Point< Real , Dim > n ){ vertex.template get<1>() = n; }
-	static void SetValue( Vertex & vertex , Real v ){}
-};
-template<>
-struct Mesh::_PlyData< false , true >
-{
-	using Factory = VertexFactory::Factory< Real , VertexFactory::PositionFactory< Real , Dim > , VertexFactory::ValueFactory< Real > >;
-	using Vertex = typename Factory::VertexType;
-	static void SetPosition( Vertex & vertex , Point< Real , Dim > p ){ vertex.template get<0>() = p; }
-	static void SetNormal( Vertex & vertex , Point< Real , Dim > n ){}
-	static void SetValue( Vertex & vertex , Real v ){ vertex.template get<1>() = v; }
-};
-template<>
-struct Mesh::_PlyData< false , false >
-{
-	using Factory = VertexFactory::PositionFactory< Real , Dim >;
-	using Vertex = typename Factory::VertexType;
-	static void SetPosition( Vertex & vertex , Point< Real , Dim > p ){ vertex = p; }
-	static void SetNormal( Vertex & vertex , Point< Real , Dim > n ){}
-	static void SetValue( Vertex & vertex , Real v ){}
-};
-
-/////////////////////////////
-// Mesh::_EdgeInfo::Hasher //
-/////////////////////////////
-inline size_t Mesh::_EdgeInfo::Hasher::operator()( const std::pair< unsigned int , unsigned int > & e ) const { return e.first; }
-
 /////////////////////
 // Mesh::_EdgeInfo //
 /////////////////////
-inline Mesh::_EdgeInfo::_EdgeInfo( void ){}
+template< typename RealType >
+inline MeshT< RealType >::_EdgeInfo::_EdgeInfo( void ) : version(0) {}
 
-inline void Mesh::_EdgeInfo::set( const std::vector< SimplexIndex< K > > & triangles )
+template< typename RealType >
+inline void MeshT< RealType >::_EdgeInfo::set( size_t vNum , const std::vector< SimplexIndex< K > > & triangles )
 {
-	unsigned int eIndex = 0;
-	for( size_t t=0 ; t<triangles.size() ; t++ )
-	{
-		for( unsigned int k=0 ; k<=K ; k++ ) for( unsigned int l=0 ; l<k ; l++ )
-		{
-			std::pair< unsigned int , unsigned int > endPoints = triangles[t][k]<triangles[t][l] ? std::make_pair( triangles[t][k] , triangles[t][l] ) : std::make_pair( triangles[t][l] , triangles[t][k] );
-			if( edgeToIndex.find( endPoints )==edgeToIndex.end() ) edgeToIndex[ endPoints ] = eIndex++;
-		}
-	}
-	indexToEdge.resize( eIndex );
-	for( auto iter=edgeToIndex.begin() ; iter!=edgeToIndex.end() ; iter++ ) indexToEdge[ iter->second ] = iter->first;
+	// A half-edge, keyed by its (sorted) end-points and storing the triangle-corner it is opposite to
+	struct HalfEdge{ unsigned long long key ; size_t corner; };
+
+	const unsigned long long _vNum = static_cast< unsigned long long >( vNum );
+	auto Key = [&]( unsigned int v1 , unsigned int v2 ){ return v1<v2 ? v1*_vNum + v2 : v2*_vNum + v1; };
+
+	std::vector< HalfEdge > halfEdges( triangles.size()*(K+1) );
+	ThreadPool::ParallelFor
+		(
+			0 , triangles.size() ,
+			[&]( size_t t )
+			{
+				for( unsigned int k=0 ; k<=K ; k++ ) halfEdges[ t*(K+1)+k ] = { Key( triangles[t][(k+1)%(K+1)] , triangles[t][(k+2)%(K+1)] ) , t*(K+1)+k };
+			}
+		);
+	RadixSort( halfEdges , []( const HalfEdge & he ){ return he.key; } , vNum ? _vNum*_vNum-1 : 0 );
+
+	// Identify the first half-edge of each edge and assign edge indices, processing blocks of half-edges in parallel
+	const size_t blocks = std::max< size_t >( 1 , std::min< size_t >( ThreadPool::NumThreads() , halfEdges.size()>>14 ) );
+	const size_t blockSize = ( halfEdges.size() + blocks - 1 ) / blocks;
+	auto IsFirst = [&]( size_t i ){ return i==0 || halfEdges[i].key!=halfEdges[i-1].key; };
+
+	std::vector< size_t > blockOffsets( blocks+1 , 0 );
+	ThreadPool::ParallelFor
+		(
+			0 , blocks ,
+			[&]( size_t b )
+			{
+				const size_t end = std::min< size_t >( halfEdges.size() , (b+1)*blockSize );
+				for( size_t i=b*blockSize ; i<end ; i++ ) if( IsFirst(i) ) blockOffsets[b+1]++;
+			} ,
+			ThreadPool::NumThreads() , ThreadPool::ParallelizationType , ThreadPool::ScheduleType::STATIC , 1
+		);
+	for( size_t b=0 ; b<blocks ; b++ ) blockOffsets[b+1] += blockOffsets[b];
+
+	indexToEdge.resize( blockOffsets[blocks] );
+	triangleEdges.resize( triangles.size() );
+	ThreadPool::ParallelFor
+		(
+			0 , blocks ,
+			[&]( size_t b )
+			{
+				const size_t end = std::min< size_t >( halfEdges.size() , (b+1)*blockSize );
+				size_t e = blockOffsets[b];
+				for( size_t i=b*blockSize ; i<end ; i++ )
+				{
+					if( IsFirst(i) ) indexToEdge[e++] = std::make_pair( static_cast< unsigned int >( halfEdges[i].key / _vNum ) , static_cast< unsigned int >( halfEdges[i].key % _vNum ) );
+					triangleEdges[ halfEdges[i].corner/(K+1) ][ halfEdges[i].corner%(K+1) ] = static_cast< unsigned int >(e-1);
+				}
+			} ,
+			ThreadPool::NumThreads() , ThreadPool::ParallelizationType , ThreadPool::ScheduleType::STATIC , 1
+		);
+
+	// Since the edges are sorted by their first end-point, the edges starting at a vertex are contiguous
+	vertexOffsets.resize( vNum+1 );
+	ThreadPool::ParallelFor
+		(
+			0 , indexToEdge.size() ,
+			[&]( size_t e )
+			{
+				size_t v = e ? indexToEdge[e-1].first+1 : 0;
+				for( ; v<=indexToEdge[e].first ; v++ ) vertexOffsets[v] = e;
+			}
+		);
+	for( size_t v = indexToEdge.size() ? indexToEdge.back().first+1 : 0 ; v<=vNum ; v++ ) vertexOffsets[v] = indexToEdge.size();
 }
 
+template< typename RealType >
+inline std::optional< unsigned int > MeshT< RealType >::_EdgeInfo::index( unsigned int v1 , unsigned int v2 ) const
+{
+	if( v1>=vertexOffsets.size()-1 ) return {};
+	auto begin = indexToEdge.begin() + vertexOffsets[v1] , end = indexToEdge.begin() + vertexOffsets[v1+1];
+	auto iter = std::lower_bound( begin , end , v2 , []( const std::pair< unsigned int , unsigned int > & e , unsigned int v ){ return e.second<v; } );
+	if( iter!=end && iter->second==v2 ) return static_cast< unsigned int >( iter - indexToEdge.begin() );
+	return {};
+}
+
+//////////////////////////
+// Mesh::_AdjacencyInfo //
+//////////////////////////
+template< typename RealType >
+inline void MeshT< RealType >::_AdjacencyInfo::set( size_t vNum , const std::vector< SimplexIndex< K > > & triangles )
+{
+	triangleCount = triangles.size();
+
+	// Count the number of (possibly repeated) neighbors of each vertex
+	std::vector< std::atomic< size_t > > counts( vNum );
+	ThreadPool::ParallelFor( 0 , vNum , [&]( size_t v ){ counts[v].store( 0 , std::memory_order_relaxed ); } );
+	ThreadPool::ParallelFor( 0 , triangles.size() , [&]( size_t t ){ for( unsigned int k=0 ; k<=K ; k++ ) counts[ triangles[t][k] ].fetch_add( K , std::memory_order_relaxed ); } );
+
+	std::vector< size_t > _offsets( vNum+1 );
+	_offsets[vNum] = ThreadPool::ParallelScan< size_t >( 0 , vNum , [&]( size_t v ){ return counts[v].load( std::memory_order_relaxed ); } , [&]( size_t v , size_t o ){ _offsets[v] = o; } , ThreadPool::ScanType::EXCLUSIVE );
+
+	// Scatter the neighbors into the per-vertex ranges
+	std::vector< unsigned int > _indices( _offsets[vNum] );
+	ThreadPool::ParallelFor( 0 , vNum , [&]( size_t v ){ counts[v].store( _offsets[v] , std::memory_order_relaxed ); } );
+	ThreadPool::ParallelFor( 0 , triangles.size() , [&]( size_t t )
+		{
+			for( unsigned int k=0 ; k<=K ; k++ )
+			{
+				size_t idx = counts[ triangles[t][k] ].fetch_add( K , std::memory_order_relaxed );
+				for( unsigned int l=1 ; l<=K ; l++ ) _indices[idx++] = triangles[t][(k+l)%(K+1)];
+			}
+		} );
+
+	// Sort the neighbors and remove duplicates
+	std::vector< size_t > valences( vNum );
+	ThreadPool::ParallelFor( 0 , vNum , [&]( size_t v )
+		{
+			unsigned int * begin = _indices.data() + _offsets[v] , * end = _indices.data() + _offsets[v+1];
+			std::sort( begin , end );
+			valences[v] = std::unique( begin , end ) - begin;
+		} );
+
+	// Compact
+	offsets.resize( vNum+1 );
+	offsets[vNum] = ThreadPool::ParallelScan< size_t >( 0 , vNum , [&]( size_t v ){ return valences[v]; } , [&]( size_t v , size_t o ){ offsets[v] = o; } , ThreadPool::ScanType::EXCLUSIVE );
+	indices.resize( offsets[vNum] );
+	ThreadPool::ParallelFor( 0 , vNum , [&]( size_t v ){ std::copy( _indices.begin()+_offsets[v] , _indices.begin()+_offsets[v]+valences[v] , indices.begin()+offsets[v] ); } );
+}
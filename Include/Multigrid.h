@@ -0,0 +1,356 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <Eigen/Sparse>
+#include <Misha/Exceptions.h>
+#include <Misha/MultiThreading.h>
+
+// A multigrid hierarchy for sparse symmetric positive definite systems, applied as a (symmetric) V-cycle
+// -- The coarser levels are obtained by clustering each level's vertices into aggregates of adjacent vertices (in the graph of the matrix)
+// -- The prolongation operators are obtained by smoothing the piecewise-constant interpolation from the aggregates with a damped Jacobi step,
+//    the restriction operators are their transposes, and the coarser systems are obtained by Galerkin projection, R * A * P
+// -- The V-cycle uses a forward multi-colored Gauss-Seidel sweep for pre-smoothing, a backward sweep for post-smoothing, and a direct solve on the coarsest level
+// -- The aggregates only depend on the sparsity pattern, so they are computed once (in analyzePattern) and re-used when the values change (in factorize)
+// -- The aggregation, the coloring, and the smoothing are performed in parallel, and the results do not depend on the number of threads
+// [NOTE] The matrices are assumed to be symmetric, so that the columns of the compressed representation can be used as rows
+struct MultigridHierarchy
+{
+	using MatrixType = Eigen::SparseMatrix< double >;
+	using StorageIndex = typename MatrixType::StorageIndex;
+
+	// The size below which a level is solved directly
+	size_t coarsestSize;
+
+	// The number of Gauss-Seidel sweeps performed before and after the coarse-grid correction
+	unsigned int smoothingIterations;
+
+	MultigridHierarchy( size_t coarsestSize=1000 , unsigned int smoothingIterations=1 ) : coarsestSize(coarsestSize) , smoothingIterations(smoothingIterations) {}
+
+	// Computes the aggregates on all levels
+	// [NOTE] The coarser aggregates are computed on the graph of aggregate adjacencies, so that no prolongation or Galerkin product is computed here
+	void analyzePattern( const MatrixType & M )
+	{
+		_levels.resize( 1 );
+		_levels[0].A.resize( M.rows() , M.cols() );
+		MatrixType pattern = M;
+		while( static_cast< size_t >( pattern.rows() )>coarsestSize )
+		{
+			Level & fine = _levels.back();
+			size_t aggregateNum = _SetAggregates( pattern , fine.aggregates );
+			if( aggregateNum==static_cast< size_t >( pattern.rows() ) ) break;
+			MatrixType T = _PiecewiseConstant( fine.aggregates , aggregateNum );
+			pattern = MatrixType( T.transpose() ) * pattern * T;
+			Level coarse;
+			coarse.A.resize( pattern.rows() , pattern.cols() );
+			_levels.push_back( coarse );
+		}
+		_levels.back().aggregates.clear();
+	}
+
+	// Computes the prolongation/restriction operators, the coarse systems, the colorings, and the coarsest factorization
+	// [NOTE] The matrix is assumed to have the sparsity pattern of the last analyzed matrix
+	void factorize( const MatrixType & M )
+	{
+		if( _levels.empty() ) MK_THROW( "Hierarchy not analyzed" );
+		_levels[0].A = M;
+		for( size_t l=0 ; l+1<_levels.size() ; l++ )
+		{
+			_setProlongation( _levels[l] );
+			_levels[l+1].A = _levels[l].R * _levels[l].A * _levels[l].P;
+		}
+		for( size_t l=0 ; l<_levels.size() ; l++ )
+		{
+			_levels[l].diagonal = _levels[l].A.diagonal();
+			_levels[l].b.resize( _levels[l].A.rows() ) , _levels[l].x.resize( _levels[l].A.rows() ) , _levels[l].r.resize( _levels[l].A.rows() );
+			if( l+1<_levels.size() ) _SetColors( _levels[l].A , _levels[l].colorOffsets , _levels[l].colorVertices );
+		}
+		_coarseSolver.compute( _levels.back().A );
+		if( _coarseSolver.info()==Eigen::Success ) _coarseDiagonal = _coarseSolver.vectorD();
+	}
+
+	Eigen::ComputationInfo info( void ) const { return _levels.empty() ? Eigen::InvalidInput : _coarseSolver.info(); }
+
+	// The number of levels in the hierarchy
+	size_t levels( void ) const { return _levels.size(); }
+
+	// The number of unknowns on the l-th level
+	size_t size( size_t l ) const { return static_cast< size_t >( _levels[l].A.rows() ); }
+
+	// Sets x to the result of applying a V-cycle to the right-hand side b, starting from a zero initial guess
+	void vCycle( const Eigen::VectorXd & b , Eigen::VectorXd & x ) const
+	{
+		_levels[0].b = b;
+		_vCycle( 0 );
+		x = _levels[0].x;
+	}
+
+protected:
+	struct Level
+	{
+		MatrixType A , P , R;
+		std::vector< StorageIndex > aggregates;
+		// The vertices, grouped by color, with the vertices of the c-th color in the range [ colorOffsets[c] , colorOffsets[c+1] )
+		std::vector< StorageIndex > colorOffsets , colorVertices;
+		Eigen::VectorXd diagonal;
+		mutable Eigen::VectorXd b , x , r;
+	};
+
+	std::vector< Level > _levels;
+	Eigen::SimplicialLDLT< MatrixType > _coarseSolver;
+	Eigen::VectorXd _coarseDiagonal;
+
+	void _vCycle( size_t l ) const
+	{
+		const Level & level = _levels[l];
+		if( l+1==_levels.size() )
+		{
+			// Solve P^t L D L^t P x = b, using the (otherwise unused) residual as the permuted buffer
+			// [NOTE] SimplicialLDLT::solve permutes in place, which allocates
+			level.r.noalias() = _coarseSolver.permutationP() * level.b;
+			_coarseSolver.matrixL().solveInPlace( level.r );
+			level.r.array() /= _coarseDiagonal.array();
+			_coarseSolver.matrixU().solveInPlace( level.r );
+			level.x.noalias() = _coarseSolver.permutationPinv() * level.r;
+			return;
+		}
+
+		// [NOTE] The products are evaluated directly into the persistent per-level vectors, so that the cycle does not allocate
+
+		level.x.setZero();
+		for( unsigned int i=0 ; i<smoothingIterations ; i++ ) _GaussSeidel< true >( level , level.b , level.x );
+
+		level.r = level.b;
+		level.r.noalias() -= level.A * level.x;
+		_levels[l+1].b.noalias() = level.R * level.r;
+		_vCycle( l+1 );
+		level.x.noalias() += level.P * _levels[l+1].x;
+
+		for( unsigned int i=0 ; i<smoothingIterations ; i++ ) _GaussSeidel< false >( level , level.b , level.x );
+	}
+
+	// Performs a single multi-colored Gauss-Seidel sweep, visiting the colors either in forward or in backward order
+	// [NOTE] Vertices of the same color are not adjacent, so they are relaxed in parallel
+	template< bool Forward >
+	static void _GaussSeidel( const Level & level , const Eigen::VectorXd & b , Eigen::VectorXd & x )
+	{
+		const StorageIndex * outer = level.A.outerIndexPtr() , * inner = level.A.innerIndexPtr();
+		const double * values = level.A.valuePtr();
+		const size_t colors = level.colorOffsets.size()-1;
+		for( size_t _c=0 ; _c<colors ; _c++ )
+		{
+			const size_t c = Forward ? _c : colors-1-_c;
+			MishaK::ThreadPool::ParallelFor
+				(
+					level.colorOffsets[c] , level.colorOffsets[c+1] ,
+					[&]( size_t k )
+					{
+						const StorageIndex i = level.colorVertices[k];
+						double sum = b[i];
+						for( StorageIndex j=outer[i] ; j<outer[i+1] ; j++ ) if( inner[j]!=i ) sum -= values[j] * x[ inner[j] ];
+						x[i] = sum / level.diagonal[i];
+					}
+				);
+		}
+	}
+
+	// A hash of the index, used to break the symmetry when selecting independent sets in parallel
+	static uint32_t _Hash( uint32_t i )
+	{
+		i ^= i>>16 , i *= 0x7feb352d;
+		i ^= i>>15 , i *= 0x846ca68b;
+		i ^= i>>16;
+		return i;
+	}
+
+	// Colors the vertices so that adjacent vertices have different colors
+	// -- In each round, the uncolored vertices whose (hashed) priority is larger than that of all their uncolored neighbors are assigned the round's color
+	static void _SetColors( const MatrixType & A , std::vector< StorageIndex > & colorOffsets , std::vector< StorageIndex > & colorVertices )
+	{
+		const StorageIndex * outer = A.outerIndexPtr() , * inner = A.innerIndexPtr();
+		const size_t n = static_cast< size_t >( A.rows() );
+		auto Priority = [&]( StorageIndex i ){ return ( static_cast< uint64_t >( _Hash( static_cast< uint32_t >(i) ) )<<32 ) | static_cast< uint64_t >(i); };
+
+		std::vector< char > colored( n , 0 ) , selected( n );
+		colorVertices.resize( n );
+		colorOffsets.resize( 1 );
+		colorOffsets[0] = 0;
+		while( static_cast< size_t >( colorOffsets.back() )<n )
+		{
+			// [NOTE] The selection is computed before any vertex is colored, so that the round's vertices form an independent set
+			MishaK::ThreadPool::ParallelFor
+				(
+					0 , n ,
+					[&]( size_t i )
+					{
+						selected[i] = !colored[i];
+						for( StorageIndex j=outer[i] ; j<outer[i+1] && selected[i] ; j++ )
+							if( !colored[ inner[j] ] && Priority( inner[j] )>Priority( static_cast< StorageIndex >(i) ) ) selected[i] = 0;
+					}
+				);
+			const StorageIndex offset = colorOffsets.back();
+			StorageIndex count = MishaK::ThreadPool::ParallelScan< StorageIndex >
+				(
+					0 , n ,
+					[&]( size_t i ){ return static_cast< StorageIndex >( selected[i] ); } ,
+					[&]( size_t i , StorageIndex o ){ if( selected[i] ) colorVertices[offset+o] = static_cast< StorageIndex >(i) , colored[i] = 1; } ,
+					MishaK::ThreadPool::ScanType::EXCLUSIVE
+				);
+			colorOffsets.push_back( offset + count );
+		}
+	}
+
+	// Clusters the vertices into aggregates in parallel, returning the number of aggregates
+	// -- First, a maximal set of roots that are at least three edges apart is selected, and each root forms an aggregate with its neighbors
+	// -- Then, each remaining vertex joins the aggregate of a neighbor
+	// [NOTE] Since the set of roots is maximal, every vertex is within two edges of a root, so every vertex is assigned
+	static size_t _SetAggregates( const MatrixType & A , std::vector< StorageIndex > & aggregates )
+	{
+		const StorageIndex * outer = A.outerIndexPtr() , * inner = A.innerIndexPtr();
+		const size_t n = static_cast< size_t >( A.rows() );
+
+		// The roots are selected as a distance-two independent set, following Bell, Dalton, and Olson (2012)
+		// -- Each vertex has a key, given by its state and its (hashed) priority, with in-set vertices having the largest keys and out-of-set vertices the smallest
+		// -- In each round, the maximal key within two edges is computed, undecided vertices whose key is the maximum join the set,
+		//    and undecided vertices within two edges of a vertex in the set leave it
+		enum State : uint64_t { OUT , UNDECIDED , IN };
+		auto Key = []( State state , size_t i ){ return ( static_cast< uint64_t >( state )<<62 ) | ( static_cast< uint64_t >( _Hash( static_cast< uint32_t >(i) )>>2 )<<32 ) | static_cast< uint64_t >(i); };
+		auto GetState = []( uint64_t key ){ return static_cast< State >( key>>62 ); };
+
+		std::vector< uint64_t > keys( n ) , _keys( n );
+		MishaK::ThreadPool::ParallelFor( 0 , n , [&]( size_t i ){ keys[i] = Key( UNDECIDED , i ); } );
+		size_t undecided = n;
+		while( undecided )
+		{
+			MishaK::ThreadPool::ParallelFor
+				(
+					0 , n ,
+					[&]( size_t i )
+					{
+						_keys[i] = keys[i];
+						for( StorageIndex j=outer[i] ; j<outer[i+1] ; j++ ) _keys[i] = std::max< uint64_t >( _keys[i] , keys[ inner[j] ] );
+					}
+				);
+			MishaK::ThreadPool::ParallelFor
+				(
+					0 , n ,
+					[&]( size_t i )
+					{
+						if( GetState( keys[i] )!=UNDECIDED ) return;
+						uint64_t key = _keys[i];
+						for( StorageIndex j=outer[i] ; j<outer[i+1] ; j++ ) key = std::max< uint64_t >( key , _keys[ inner[j] ] );
+						if     ( key==keys[i]           ) keys[i] = Key( IN , i );
+						else if( GetState( key )==IN ) keys[i] = Key( OUT , i );
+					}
+				);
+			undecided = MishaK::ThreadPool::ParallelReduce( 0 , n , [&]( size_t i ){ return static_cast< size_t >( GetState( keys[i] )==UNDECIDED ); } , static_cast< size_t >(0) , std::plus< size_t >() );
+		}
+
+		// Number the roots in order and assign their neighbors to their aggregates
+		// [NOTE] The roots are at least three edges apart, so a vertex is adjacent to at most one root
+		aggregates.resize( n );
+		std::vector< StorageIndex > _aggregates( n );
+		StorageIndex count = MishaK::ThreadPool::ParallelScan< StorageIndex >
+			(
+				0 , n ,
+				[&]( size_t i ){ return static_cast< StorageIndex >( GetState( keys[i] )==IN ); } ,
+				[&]( size_t i , StorageIndex o ){ _aggregates[i] = GetState( keys[i] )==IN ? o : -1; } ,
+				MishaK::ThreadPool::ScanType::EXCLUSIVE
+			);
+		MishaK::ThreadPool::ParallelFor
+			(
+				0 , n ,
+				[&]( size_t i )
+				{
+					aggregates[i] = _aggregates[i];
+					for( StorageIndex j=outer[i] ; j<outer[i+1] && aggregates[i]==-1 ; j++ ) aggregates[i] = _aggregates[ inner[j] ];
+				}
+			);
+
+		// [NOTE] Vertices are assigned to aggregates from the first pass, so that the aggregates do not grow in chains
+		std::swap( aggregates , _aggregates );
+		MishaK::ThreadPool::ParallelFor
+			(
+				0 , n ,
+				[&]( size_t i )
+				{
+					aggregates[i] = _aggregates[i];
+					for( StorageIndex j=outer[i] ; j<outer[i+1] && aggregates[i]==-1 ; j++ ) aggregates[i] = _aggregates[ inner[j] ];
+				}
+			);
+		return static_cast< size_t >( count );
+	}
+
+	// Returns the piecewise-constant interpolation from the aggregates
+	static MatrixType _PiecewiseConstant( const std::vector< StorageIndex > & aggregates , size_t aggregateNum )
+	{
+		const Eigen::Index n = static_cast< Eigen::Index >( aggregates.size() );
+		MatrixType T( n , aggregateNum );
+		T.resizeNonZeros( n );
+		for( size_t j=0 ; j<=aggregateNum ; j++ ) T.outerIndexPtr()[j] = 0;
+		for( Eigen::Index i=0 ; i<n ; i++ ) T.outerIndexPtr()[ aggregates[i]+1 ]++;
+		for( size_t j=0 ; j<aggregateNum ; j++ ) T.outerIndexPtr()[j+1] += T.outerIndexPtr()[j];
+		std::vector< StorageIndex > counts( T.outerIndexPtr() , T.outerIndexPtr()+aggregateNum );
+		for( Eigen::Index i=0 ; i<n ; i++ )
+		{
+			StorageIndex idx = counts[ aggregates[i] ]++;
+			T.innerIndexPtr()[idx] = static_cast< StorageIndex >( i ) , T.valuePtr()[idx] = 1.;
+		}
+		return T;
+	}
+
+	// Sets the prolongation and restriction operators from the aggregates and the level's system matrix
+	static void _setProlongation( Level & level )
+	{
+		const Eigen::Index n = level.A.rows();
+		const size_t aggregateNum = level.aggregates.size() ? static_cast< size_t >( *std::max_element( level.aggregates.begin() , level.aggregates.end() )+1 ) : 0;
+		MatrixType T = _PiecewiseConstant( level.aggregates , aggregateNum );
+
+		// The damped Jacobi smoothing, P = ( I - omega D^{-1} A ) T, with omega = 4 / ( 3 \rho( D^{-1} A ) )
+		// [NOTE] The spectral radius is bounded using Gershgorin's theorem
+		const StorageIndex * outer = level.A.outerIndexPtr();
+		const double * values = level.A.valuePtr();
+		Eigen::VectorXd diagonal = level.A.diagonal();
+		double rho = 0;
+		for( Eigen::Index i=0 ; i<n ; i++ )
+		{
+			double sum = 0;
+			for( StorageIndex j=outer[i] ; j<outer[i+1] ; j++ ) sum += std::abs( values[j] );
+			rho = std::max< double >( rho , sum / diagonal[i] );
+		}
+		const double omega = 4. / ( 3. * rho );
+		Eigen::VectorXd scale = diagonal.cwiseInverse() * omega;
+
+		level.P = T - scale.asDiagonal() * ( level.A * T );
+		level.R = level.P.transpose();
+	}
+};
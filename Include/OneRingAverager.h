@@ -0,0 +1,138 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <Misha/MultiThreading.h>
+#include "Mesh.h"
+#include "SoAPoints.h"
+
+namespace MishaK
+{
+	namespace AdvancedGraphics
+	{
+		// An engine for repeatedly blending per-vertex data toward the average over the vertices' one-rings:
+		//		x[v] <- x[v] + lambda * ( 1/|N(v)| \sum_{w\in N(v)} x[w] - x[v] )
+		// -- The update is computed in parallel over the mesh's (compressed) adjacency, with sums accumulated in double precision
+		// -- The results are written into a persistent back buffer that is then swapped with the input, so no per-step allocation or copying is performed
+		// -- Vertices without neighbors keep their data
+		// [NOTE] The mesh's adjacency needs to have been set before averaging (it is re-read, and validated, on every step)
+		template< typename Real >
+		struct OneRingAverager
+		{
+			static const unsigned int Dim = MeshT< Real >::Dim;
+
+			OneRingAverager( const MeshT< Real > & mesh );
+
+			// Performs the requested number of averaging steps on the per-vertex values
+			void average( std::vector< Real > & values , double lambda=1. , unsigned int steps=1 );
+
+			// Performs the requested number of averaging steps on the per-vertex positions
+			void average( SoAPoints< Real , Dim > & points , double lambda=1. , unsigned int steps=1 );
+
+		protected:
+			const MeshT< Real > & _mesh;
+			std::vector< Real > _values;
+			SoAPoints< Real , Dim > _points;
+
+			// The averaging kernel, applied to each of the (contiguous) channel arrays
+			template< unsigned int Channels >
+			void _average( const Real * const in[Channels] , Real * const out[Channels] , double lambda ) const;
+		};
+
+		/////////////////////
+		// OneRingAverager //
+		/////////////////////
+		template< typename Real >
+		OneRingAverager< Real >::OneRingAverager( const MeshT< Real > & mesh ) : _mesh(mesh){}
+
+		template< typename Real >
+		void OneRingAverager< Real >::average( std::vector< Real > & values , double lambda , unsigned int steps )
+		{
+			if( values.size()!=_mesh.vertices.size() ) MK_THROW( "Number of values does not match number of vertices: " , values.size() , " != " , _mesh.vertices.size() );
+			_values.resize( values.size() );
+			for( unsigned int s=0 ; s<steps ; s++ )
+			{
+				const Real * in[] = { values.data() };
+				Real * out[] = { _values.data() };
+				_average< 1 >( in , out , lambda );
+				std::swap( values , _values );
+			}
+		}
+
+		template< typename Real >
+		void OneRingAverager< Real >::average( SoAPoints< Real , Dim > & points , double lambda , unsigned int steps )
+		{
+			if( points.size()!=_mesh.vertices.size() ) MK_THROW( "Number of points does not match number of vertices: " , points.size() , " != " , _mesh.vertices.size() );
+			if( _points.size()!=points.size() ) _points.resize( points.size() );
+			for( unsigned int s=0 ; s<steps ; s++ )
+			{
+				const Real * in[Dim];
+				Real * out[Dim];
+				for( unsigned int d=0 ; d<Dim ; d++ ) in[d] = points[d] , out[d] = _points[d];
+				_average< Dim >( in , out , lambda );
+				std::swap( points , _points );
+			}
+		}
+
+		template< typename Real >
+		template< unsigned int Channels >
+		void OneRingAverager< Real >::_average( const Real * const in[Channels] , Real * const out[Channels] , double lambda ) const
+		{
+			const size_t * offsets = _mesh.adjacencyOffsets().data();
+			const unsigned int * neighbors = _mesh.adjacencyIndices().data();
+
+			ThreadPool::ParallelFor
+				(
+					0 , _mesh.vertices.size() ,
+					[&]( size_t v )
+					{
+						const size_t begin = offsets[v] , end = offsets[v+1];
+						if( begin==end )
+						{
+							for( unsigned int c=0 ; c<Channels ; c++ ) out[c][v] = in[c][v];
+							return;
+						}
+
+						double sums[Channels];
+						for( unsigned int c=0 ; c<Channels ; c++ ) sums[c] = 0;
+						for( size_t j=begin ; j<end ; j++ )
+						{
+							const unsigned int w = neighbors[j];
+							for( unsigned int c=0 ; c<Channels ; c++ ) sums[c] += in[c][w];
+						}
+
+						const double scale = lambda / static_cast< double >( end-begin );
+						for( unsigned int c=0 ; c<Channels ; c++ ) out[c][v] = static_cast< Real >( in[c][v] + sums[c] * scale - lambda * in[c][v] );
+					}
+				);
+		}
+	}
+}
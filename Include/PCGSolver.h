@@ -0,0 +1,275 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <Eigen/Sparse>
+#include <Misha/MultiThreading.h>
+#include <Misha/Miscellany.h>
+#include <Misha/Trace.h>
+#include <Misha/Exceptions.h>
+#include "Multigrid.h"
+
+// A multi-threaded preconditioned conjugate-gradients solver for symmetric positive definite systems,
+// exposing the interface of the (refactorizing) direct solvers
+// -- The matrix-vector products, vector updates, and inner products are computed in parallel
+// -- The preconditioner is either the inverse diagonal (Jacobi), an incomplete Cholesky factorization, or a multigrid V-cycle
+// -- The solve can be warm-started from an initial guess (e.g. the previous frame's solution)
+// -- The number of iterations and the relative residual of the last solve are recorded
+// [NOTE] The matrix is assumed to be symmetric, so that the columns of the compressed representation can be used as rows
+struct PCGSolver
+{
+	using MatrixType = Eigen::SparseMatrix< double >;
+	using StorageIndex = typename MatrixType::StorageIndex;
+
+	enum PreconditionerType
+	{
+		JACOBI ,
+		INCOMPLETE_CHOLESKY ,
+		MULTIGRID
+	};
+	static inline const std::vector< std::string > PreconditionerTypeNames = { "jacobi" , "ichol" , "multigrid" };
+
+	// The relative residual at which the iterations are terminated
+	double tolerance;
+
+	// The maximum number of iterations per solve
+	unsigned int maxIterations;
+
+	PCGSolver( PreconditionerType preconditioner=JACOBI , double tolerance=1e-8 , unsigned int maxIterations=1000 )
+		: tolerance(tolerance) , maxIterations(maxIterations) , _preconditioner(preconditioner) , _info(Eigen::Success) ,
+		_analysisTime(0) , _factorizationTime(0) , _analysisCount(0) , _factorizationCount(0) , _iterations(0) , _error(0) {}
+
+	// Performs the symbolic analysis of the preconditioner
+	void analyzePattern( const MatrixType & M )
+	{
+		MK_TRACE_SCOPE( "PCGSolver::analyzePattern" );
+		double t = MishaK::Miscellany::Time();
+		if     ( _preconditioner==INCOMPLETE_CHOLESKY ) _ichol.analyzePattern( M );
+		else if( _preconditioner==MULTIGRID ) _multigrid.analyzePattern( M );
+		_analysisTime = MishaK::Miscellany::Time() - t;
+		_analysisCount++;
+
+		_outer.assign( M.outerIndexPtr() , M.outerIndexPtr() + M.outerSize() + 1 );
+		_inner.assign( M.innerIndexPtr() , M.innerIndexPtr() + M.nonZeros() );
+	}
+
+	// Stores the matrix and computes the preconditioner
+	void factorize( const MatrixType & M )
+	{
+		MK_TRACE_SCOPE( "PCGSolver::factorize" );
+		double t = MishaK::Miscellany::Time();
+		_M = M;
+		_M.makeCompressed();
+		_info = Eigen::Success;
+		if( _preconditioner==INCOMPLETE_CHOLESKY )
+		{
+			_ichol.factorize( _M );
+			_info = _ichol.info();
+		}
+		else if( _preconditioner==MULTIGRID )
+		{
+			_multigrid.factorize( _M );
+			_info = _multigrid.info();
+		}
+		else
+		{
+			_invDiagonal = _M.diagonal();
+			for( Eigen::Index i=0 ; i<_invDiagonal.size() ; i++ )
+				if( _invDiagonal[i]>0 ) _invDiagonal[i] = 1./_invDiagonal[i];
+				else _info = Eigen::NumericalIssue;
+		}
+		_factorizationTime = MishaK::Miscellany::Time() - t;
+		_factorizationCount++;
+	}
+
+	// Performs the symbolic analysis and computes the preconditioner
+	void compute( const MatrixType & M ){ analyzePattern( M ) , factorize( M ); }
+
+	// Computes the preconditioner, preceded by the symbolic analysis only if the sparsity pattern has changed
+	void refactorize( const MatrixType & M )
+	{
+		if( !hasPattern( M ) ) analyzePattern( M );
+		factorize( M );
+	}
+
+	// Returns true if the matrix has the sparsity pattern of the last analyzed matrix
+	bool hasPattern( const MatrixType & M ) const
+	{
+		if( !M.isCompressed() || static_cast< size_t >( M.outerSize()+1 )!=_outer.size() || static_cast< size_t >( M.nonZeros() )!=_inner.size() ) return false;
+		return std::equal( _outer.begin() , _outer.end() , M.outerIndexPtr() ) && std::equal( _inner.begin() , _inner.end() , M.innerIndexPtr() );
+	}
+
+	Eigen::ComputationInfo info( void ) const { return _info; }
+
+	// Solves for all the columns of the right-hand side, using the input values of X as the initial guess
+	// [NOTE] The info is set to Eigen::NoConvergence if any column did not reach the prescribed tolerance
+	template< typename Rhs , typename Derived >
+	void solveWithGuess( const Eigen::MatrixBase< Rhs > & B , Eigen::MatrixBase< Derived > & X )
+	{
+		MK_TRACE_SCOPE( "PCGSolver::solve" );
+		if( B.rows()!=_M.rows() || X.rows()!=_M.rows() || B.cols()!=X.cols() ) MK_THROW( "Right-hand side / solution size does not match: " , B.rows() , "x" , B.cols() , " / " , X.rows() , "x" , X.cols() , " != " , _M.rows() );
+		_iterations = 0 , _error = 0;
+		bool converged = true;
+		for( Eigen::Index c=0 ; c<B.cols() ; c++ )
+		{
+			_b = B.col(c);
+			_x = X.col(c);
+			unsigned int iterations;
+			double error;
+			converged &= _solve( iterations , error );
+			X.col(c) = _x;
+			_iterations = std::max< unsigned int >( _iterations , iterations );
+			_error = std::max< double >( _error , error );
+		}
+		if( _info==Eigen::Success && !converged ) _info = Eigen::NoConvergence;
+		else if( _info==Eigen::NoConvergence && converged ) _info = Eigen::Success;
+	}
+
+	// Solves for all the columns of the right-hand side, in place, starting from a zero initial guess
+	template< typename Derived >
+	void solveInPlace( Eigen::MatrixBase< Derived > & X )
+	{
+		_B = X;
+		X.setZero();
+		solveWithGuess( _B , X );
+	}
+
+	// The time (in seconds) spent in the last symbolic analysis and preconditioner computation
+	double analysisTime( void ) const { return _analysisTime; }
+	double factorizationTime( void ) const { return _factorizationTime; }
+
+	// The number of symbolic analyses and preconditioner computations performed
+	unsigned int analysisCount( void ) const { return _analysisCount; }
+	unsigned int factorizationCount( void ) const { return _factorizationCount; }
+
+	// The multigrid hierarchy (if the multigrid preconditioner is used)
+	const MultigridHierarchy & multigrid( void ) const { return _multigrid; }
+
+	// The (maximum over the columns) number of iterations and relative residual of the last solve
+	unsigned int iterations( void ) const { return _iterations; }
+	double error( void ) const { return _error; }
+
+protected:
+	PreconditionerType _preconditioner;
+	Eigen::ComputationInfo _info;
+	MatrixType _M;
+	std::vector< StorageIndex > _outer , _inner;
+	Eigen::VectorXd _invDiagonal;
+	Eigen::IncompleteCholesky< double , Eigen::Lower , Eigen::AMDOrdering< StorageIndex > > _ichol;
+	MultigridHierarchy _multigrid;
+	Eigen::VectorXd _b , _x , _r , _z , _p , _q;
+	mutable Eigen::VectorXd _y;
+	Eigen::MatrixXd _B;
+	std::vector< double > _partials;
+	double _analysisTime , _factorizationTime;
+	unsigned int _analysisCount , _factorizationCount;
+	unsigned int _iterations;
+	double _error;
+
+	// Returns the sum of the per-index values
+	// [NOTE] The values are summed over fixed-size blocks, so the inner products (and hence the iterates) do not depend on the number of threads or the schedule,
+	// and the per-block sums are stored in a persistent buffer, so the reduction does not allocate
+	template< typename Functor /* = std::function< double ( size_t ) > */ >
+	double _sum( Functor F ){ return MishaK::ThreadPool::ParallelReduce( 0 , static_cast< size_t >( _M.rows() ) , F , 0. , std::plus< double >() , _partials ); }
+
+	// Sets q = M * p
+	void _multiply( const Eigen::VectorXd & p , Eigen::VectorXd & q ) const
+	{
+		const StorageIndex * outer = _M.outerIndexPtr() , * inner = _M.innerIndexPtr();
+		const double * values = _M.valuePtr();
+		MishaK::ThreadPool::ParallelFor
+			(
+				0 , static_cast< size_t >( _M.rows() ) ,
+				[&]( size_t i )
+				{
+					double sum = 0;
+					for( StorageIndex j=outer[i] ; j<outer[i+1] ; j++ ) sum += values[j] * p[ inner[j] ];
+					q[i] = sum;
+				}
+			);
+	}
+
+	// Sets z = P^{-1} r
+	void _precondition( const Eigen::VectorXd & r , Eigen::VectorXd & z ) const
+	{
+		if     ( _preconditioner==INCOMPLETE_CHOLESKY )
+		{
+			// [NOTE] This mirrors IncompleteCholesky::solve, but works in a persistent buffer so that no temporaries are allocated
+			const Eigen::VectorXd & scale = _ichol.scalingS();
+			_y.noalias() = _ichol.permutationP() * r;
+			_y.array() *= scale.array();
+			_ichol.matrixL().template triangularView< Eigen::Lower >().solveInPlace( _y );
+			_ichol.matrixL().adjoint().template triangularView< Eigen::Upper >().solveInPlace( _y );
+			_y.array() *= scale.array();
+			z.noalias() = _ichol.permutationP().inverse() * _y;
+		}
+		else if( _preconditioner==MULTIGRID ) _multigrid.vCycle( r , z );
+		else MishaK::ThreadPool::ParallelForChunks( 0 , static_cast< size_t >( _M.rows() ) , [&]( size_t begin , size_t end ){ z.segment( begin , end-begin ) = _invDiagonal.segment( begin , end-begin ).cwiseProduct( r.segment( begin , end-begin ) ); } );
+	}
+
+	// Runs conjugate-gradients on _x, returning true if the tolerance was reached
+	bool _solve( unsigned int & iterations , double & error )
+	{
+		const Eigen::Index n = _M.rows();
+		_r.resize( n ) , _z.resize( n ) , _p.resize( n ) , _q.resize( n );
+		iterations = 0 , error = 0;
+
+		const double bNorm2 = _sum( [&]( size_t i ){ return _b[i]*_b[i]; } );
+		if( !bNorm2 ){ _x.setZero() ; return true; }
+		const double threshold2 = tolerance * tolerance * bNorm2;
+
+		_multiply( _x , _q );
+		double rNorm2 = _sum( [&]( size_t i ){ _r[i] = _b[i] - _q[i] ; return _r[i]*_r[i]; } );
+		if( rNorm2<=threshold2 ){ error = sqrt( rNorm2 / bNorm2 ) ; return true; }
+
+		_precondition( _r , _z );
+		_p = _z;
+		double rz = _sum( [&]( size_t i ){ return _r[i]*_z[i]; } );
+
+		while( iterations<maxIterations )
+		{
+			_multiply( _p , _q );
+			const double alpha = rz / _sum( [&]( size_t i ){ return _p[i]*_q[i]; } );
+			rNorm2 = _sum( [&]( size_t i ){ _x[i] += alpha * _p[i] ; _r[i] -= alpha * _q[i] ; return _r[i]*_r[i]; } );
+			iterations++;
+			if( rNorm2<=threshold2 ) break;
+
+			_precondition( _r , _z );
+			const double _rz = _sum( [&]( size_t i ){ return _r[i]*_z[i]; } );
+			const double beta = _rz / rz;
+			rz = _rz;
+			MishaK::ThreadPool::ParallelForChunks( 0 , static_cast< size_t >( n ) , [&]( size_t begin , size_t end ){ _p.segment( begin , end-begin ) = _z.segment( begin , end-begin ) + beta * _p.segment( begin , end-begin ); } );
+		}
+		error = sqrt( rNorm2 / bNorm2 );
+		return rNorm2<=threshold2;
+	}
+};
@@ -33,12 +33,251 @@ DAMAGE.
 
 //#define USE_EIGEN_PARDISO
 
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 #include <Eigen/Sparse>
+#include <Misha/Miscellany.h>
+#include <Misha/Trace.h>
+#include <Misha/Exceptions.h>
+#include "PCGSolver.h"
 #ifdef USE_EIGEN_PARDISO
 #include <Eigen/PardisoSupport>
-using LLtSolver = Eigen::PardisoLLT< Eigen::SparseMatrix< double , Eigen::ColMajor , __int64 > >;
-using LDLtSolver = Eigen::PardisoLDLT< Eigen::SparseMatrix< double , Eigen::ColMajor , __int64 > >;
+#endif // USE_EIGEN_PARDISO
+
+// A wrapper around an Eigen sparse solver that separates the symbolic and numerical phases of the factorization
+// -- The sparsity pattern of the last analyzed matrix is stored so that calls to refactorize only re-run the
+//    (fill-reducing ordering and) symbolic analysis when the pattern has changed
+// -- The times spent in the last symbolic and numerical phases are recorded separately
+// -- Multiple right-hand sides can be solved for in a single (blocked) pass over the factor
+template< typename EigenSolver >
+struct RefactorizingSolver : public EigenSolver
+{
+	using MatrixType = typename EigenSolver::MatrixType;
+	using StorageIndex = typename MatrixType::StorageIndex;
+
+	RefactorizingSolver( void ) : _analysisTime(0) , _factorizationTime(0) , _analysisCount(0) , _factorizationCount(0) {}
+	RefactorizingSolver( const MatrixType & M ) : RefactorizingSolver() { compute( M ); }
+
+	// Performs the symbolic analysis
+	void analyzePattern( const MatrixType & M )
+	{
+		MK_TRACE_SCOPE( "RefactorizingSolver::analyzePattern" );
+		double t = MishaK::Miscellany::Time();
+		EigenSolver::analyzePattern( M );
+		_analysisTime = MishaK::Miscellany::Time() - t;
+		_analysisCount++;
+
+		_outer.assign( M.outerIndexPtr() , M.outerIndexPtr() + M.outerSize() + 1 );
+		_inner.assign( M.innerIndexPtr() , M.innerIndexPtr() + M.nonZeros() );
+	}
+
+	// Performs the numerical factorization
+	// [NOTE] The matrix is assumed to have the sparsity pattern of the last analyzed matrix
+	void factorize( const MatrixType & M )
+	{
+		MK_TRACE_SCOPE( "RefactorizingSolver::factorize" );
+		double t = MishaK::Miscellany::Time();
+		EigenSolver::factorize( M );
+		_factorizationTime = MishaK::Miscellany::Time() - t;
+		_factorizationCount++;
+	}
+
+	// Performs the symbolic analysis and the numerical factorization
+	void compute( const MatrixType & M ){ analyzePattern( M ) , factorize( M ); }
+
+	// Performs the numerical factorization, preceded by the symbolic analysis only if the sparsity pattern has changed
+	void refactorize( const MatrixType & M )
+	{
+		if( !hasPattern( M ) ) analyzePattern( M );
+		factorize( M );
+	}
+
+	// Returns true if the matrix has the sparsity pattern of the last analyzed matrix
+	bool hasPattern( const MatrixType & M ) const
+	{
+		if( !M.isCompressed() || static_cast< size_t >( M.outerSize()+1 )!=_outer.size() || static_cast< size_t >( M.nonZeros() )!=_inner.size() ) return false;
+		return std::equal( _outer.begin() , _outer.end() , M.outerIndexPtr() ) && std::equal( _inner.begin() , _inner.end() , M.innerIndexPtr() );
+	}
+
+	// Solves for all the columns of the right-hand side, in place
+	// For the simplicial solvers, the forward and backward substitutions each make a single pass over the factor,
+	// with the columns of the right-hand side interleaved in a (persistent) row-major buffer
+	// [NOTE] For a single column, or for other solvers, this defers to the solver's own solve
+	template< typename Derived >
+	void solveInPlace( Eigen::MatrixBase< Derived > & X )
+	{
+		MK_TRACE_SCOPE( "RefactorizingSolver::solve" );
+		if constexpr( std::is_base_of_v< Eigen::SimplicialCholeskyBase< EigenSolver > , EigenSolver > )
+		{
+			if( X.cols()==1 ){ X = EigenSolver::solve( X ).eval() ; return; }
+			if( X.rows()!=EigenSolver::matrixL().cols() ) MK_THROW( "Right-hand side size does not match: " , X.rows() , " != " , EigenSolver::matrixL().cols() );
+
+			// [NOTE] The permutations are applied row by row, into the persistent buffer, so that the solve does not allocate
+			_Y.resize( X.rows() , X.cols() );
+			if( EigenSolver::permutationP().size() )
+			{
+				const StorageIndex * p = EigenSolver::permutationP().indices().data();
+				MishaK::ThreadPool::ParallelFor( 0 , static_cast< size_t >( X.rows() ) , [&]( size_t i ){ _Y.row( p[i] ) = X.row( i ); } );
+			}
+			else _Y = X;
+
+			// Use a compile-time number of channels for the common cases
+			switch( X.cols() )
+			{
+				case 2: _substitute< 2 >( _Y.data() , 2 ) ; break;
+				case 3: _substitute< 3 >( _Y.data() , 3 ) ; break;
+				case 4: _substitute< 4 >( _Y.data() , 4 ) ; break;
+				default: _substitute< Eigen::Dynamic >( _Y.data() , X.cols() );
+			}
+
+			if( EigenSolver::permutationP().size() )
+			{
+				const StorageIndex * p = EigenSolver::permutationP().indices().data();
+				MishaK::ThreadPool::ParallelFor( 0 , static_cast< size_t >( X.rows() ) , [&]( size_t i ){ X.row( i ) = _Y.row( p[i] ); } );
+			}
+			else X = _Y;
+		}
+		else X = EigenSolver::solve( X ).eval();
+	}
+
+	// Solves for all the columns of the right-hand side
+	// [NOTE] The initial guess is ignored, this is provided for compatibility with the iterative solvers
+	template< typename Rhs , typename Derived >
+	void solveWithGuess( const Eigen::MatrixBase< Rhs > & B , Eigen::MatrixBase< Derived > & X ){ X = B ; solveInPlace( X ); }
+
+	// The time (in seconds) spent in the last symbolic analysis and numerical factorization
+	double analysisTime( void ) const { return _analysisTime; }
+	double factorizationTime( void ) const { return _factorizationTime; }
+
+	// The number of symbolic analyses and numerical factorizations performed
+	unsigned int analysisCount( void ) const { return _analysisCount; }
+	unsigned int factorizationCount( void ) const { return _factorizationCount; }
+
+protected:
+	std::vector< StorageIndex > _outer , _inner;
+	Eigen::Matrix< double , Eigen::Dynamic , Eigen::Dynamic , Eigen::RowMajor > _Y;
+	double _analysisTime , _factorizationTime;
+	unsigned int _analysisCount , _factorizationCount;
+
+	// Performs the forward, diagonal, and backward substitutions on the (permuted) row-major right-hand side
+	// [NOTE] The LDLt factor has an implicit unit diagonal, while the LLt factor stores the diagonal first in each column
+	template< int Channels >
+	void _substitute( double * y , Eigen::Index channels ) const
+	{
+		const Eigen::Index k = Channels==Eigen::Dynamic ? channels : Channels;
+		const MatrixType & L = EigenSolver::matrixL().nestedExpression();
+		const StorageIndex * outer = L.outerIndexPtr() , * inner = L.innerIndexPtr();
+		const double * values = L.valuePtr();
+		const Eigen::Index n = L.cols();
+
+		// Forward substitution, L y = y
+		for( Eigen::Index j=0 ; j<n ; j++ )
+		{
+			double * yj = y + j*k;
+			for( StorageIndex p=outer[j] ; p<outer[j+1] ; p++ )
+			{
+				const Eigen::Index i = inner[p];
+				const double v = values[p];
+				if( i==j ) for( Eigen::Index c=0 ; c<k ; c++ ) yj[c] /= v;
+				else
+				{
+					double * yi = y + i*k;
+					for( Eigen::Index c=0 ; c<k ; c++ ) yi[c] -= v * yj[c];
+				}
+			}
+		}
+
+		// Diagonal solve, D y = y
+		if constexpr( std::is_same_v< EigenSolver , Eigen::SimplicialLDLT< MatrixType > > )
+		{
+			// [NOTE] vectorD returns a copy, so the stored diagonal is read directly
+			const auto & D = EigenSolver::m_diag;
+			for( Eigen::Index j=0 ; j<n ; j++ ) for( Eigen::Index c=0 ; c<k ; c++ ) y[j*k+c] /= D[j];
+		}
+
+		// Backward substitution, L^t y = y
+		for( Eigen::Index j=n-1 ; j>=0 ; j-- )
+		{
+			double * yj = y + j*k;
+			double diagonal = 1.;
+			for( StorageIndex p=outer[j] ; p<outer[j+1] ; p++ )
+			{
+				const Eigen::Index i = inner[p];
+				const double v = values[p];
+				if( i==j ) diagonal = v;
+				else
+				{
+					const double * yi = y + i*k;
+					for( Eigen::Index c=0 ; c<k ; c++ ) yj[c] -= v * yi[c];
+				}
+			}
+			if( diagonal!=1. ) for( Eigen::Index c=0 ; c<k ; c++ ) yj[c] /= diagonal;
+		}
+	}
+};
+
+#ifdef USE_EIGEN_PARDISO
+using LLtSolver = RefactorizingSolver< Eigen::PardisoLLT< Eigen::SparseMatrix< double , Eigen::ColMajor , __int64 > > >;
+using LDLtSolver = RefactorizingSolver< Eigen::PardisoLDLT< Eigen::SparseMatrix< double , Eigen::ColMajor , __int64 > > >;
 #else //  !USE_EIGEN_PARDISO
-using LLtSolver = Eigen::SimplicialLLT< Eigen::SparseMatrix< double > >;
-using LDLtSolver = Eigen::SimplicialLDLT< Eigen::SparseMatrix< double > >;
+using LLtSolver = RefactorizingSolver< Eigen::SimplicialLLT< Eigen::SparseMatrix< double > > >;
+using LDLtSolver = RefactorizingSolver< Eigen::SimplicialLDLT< Eigen::SparseMatrix< double > > >;
 #endif // USE_EIGEN_PARDISO
+
+// A solver for symmetric positive definite systems whose back-end (direct or preconditioned conjugate-gradients) is selected at runtime
+struct SystemSolver
+{
+	using MatrixType = Eigen::SparseMatrix< double >;
+
+	enum Type
+	{
+		DIRECT ,
+		PCG_JACOBI ,
+		PCG_INCOMPLETE_CHOLESKY ,
+		PCG_MULTIGRID
+	};
+	static inline const std::vector< std::string > TypeNames = { "direct" , "jacobi" , "ichol" , "multigrid" };
+
+	SystemSolver( Type type=DIRECT , double tolerance=1e-8 , unsigned int maxIterations=1000 )
+		: _type(type) , _iterative( _PreconditionerType( type ) , tolerance , maxIterations ) {}
+
+	Type type( void ) const { return _type; }
+	bool iterative( void ) const { return _type!=DIRECT; }
+
+	void compute( const MatrixType & M ){ if( iterative() ) _iterative.compute( M ) ; else _direct.compute( M ); }
+	void refactorize( const MatrixType & M ){ if( iterative() ) _iterative.refactorize( M ) ; else _direct.refactorize( M ); }
+	Eigen::ComputationInfo info( void ) const { return iterative() ? _iterative.info() : _direct.info(); }
+
+	template< typename Derived >
+	void solveInPlace( Eigen::MatrixBase< Derived > & X ){ if( iterative() ) _iterative.solveInPlace( X ) ; else _direct.solveInPlace( X ); }
+
+	// Solves for all the columns of the right-hand side, warm-starting the iterative solvers from the input values of X
+	template< typename Rhs , typename Derived >
+	void solveWithGuess( const Eigen::MatrixBase< Rhs > & B , Eigen::MatrixBase< Derived > & X ){ if( iterative() ) _iterative.solveWithGuess( B , X ) ; else _direct.solveWithGuess( B , X ); }
+
+	double analysisTime( void ) const { return iterative() ? _iterative.analysisTime() : _direct.analysisTime(); }
+	double factorizationTime( void ) const { return iterative() ? _iterative.factorizationTime() : _direct.factorizationTime(); }
+
+	// The number of iterations and relative residual of the last solve (zero for the direct solver)
+	unsigned int iterations( void ) const { return iterative() ? _iterative.iterations() : 0; }
+	double error( void ) const { return iterative() ? _iterative.error() : 0; }
+
+	// The multigrid hierarchy (if the multigrid solver is used)
+	const MultigridHierarchy & multigrid( void ) const { return _iterative.multigrid(); }
+
+protected:
+	Type _type;
+	LDLtSolver _direct;
+	PCGSolver _iterative;
+
+	static PCGSolver::PreconditionerType _PreconditionerType( Type type )
+	{
+		switch( type )
+		{
+			case PCG_INCOMPLETE_CHOLESKY: return PCGSolver::INCOMPLETE_CHOLESKY;
+			case PCG_MULTIGRID:           return PCGSolver::MULTIGRID;
+			default:                      return PCGSolver::JACOBI;
+		}
+	}
+};
@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <Misha/MultiThreading.h>
+
+namespace MishaK
+{
+	namespace AdvancedGraphics
+	{
+		// Sorts the data in increasing order of the (unsigned integer) keys returned by the functor
+		// using a parallel least-significant-digit radix sort.
+		// -- The sort is stable
+		// -- Only the bytes needed to represent maxKey are processed, and passes over bytes shared by all keys are skipped
+		template< typename Data , typename KeyFunctor /* = std::function< unsigned long long ( const Data & ) > */ >
+		void RadixSort( std::vector< Data > & data , KeyFunctor key , unsigned long long maxKey );
+
+		////////////////////
+		// Implementation //
+		////////////////////
+		template< typename Data , typename KeyFunctor >
+		void RadixSort( std::vector< Data > & data , KeyFunctor key , unsigned long long maxKey )
+		{
+			static const unsigned int RadixBits = 8;
+			static const size_t Radix = static_cast< size_t >(1)<<RadixBits;
+			// The minimum number of elements processed by a single block
+			static const size_t MinBlockSize = 1<<14;
+
+			unsigned int passes = 0;
+			for( unsigned long long k=maxKey ; k ; k>>=RadixBits ) passes++;
+			if( data.size()<2 || !passes ) return;
+
+			const size_t n = data.size();
+			const size_t blocks = std::max< size_t >( 1 , std::min< size_t >( ThreadPool::NumThreads() , n / MinBlockSize ) );
+			const size_t blockSize = ( n + blocks - 1 ) / blocks;
+
+			std::vector< Data > temp( n );
+			std::vector< size_t > histograms( blocks * Radix );
+
+			for( unsigned int p=0 ; p<passes ; p++ )
+			{
+				const unsigned int shift = p * RadixBits;
+				auto Digit = [&]( const Data & d ){ return static_cast< size_t >( ( key(d)>>shift ) & ( Radix-1 ) ); };
+
+				// Compute the per-block histograms
+				ThreadPool::ParallelFor
+					(
+						0 , blocks ,
+						[&]( size_t b )
+						{
+							size_t * histogram = histograms.data() + b*Radix;
+							for( size_t r=0 ; r<Radix ; r++ ) histogram[r] = 0;
+							const size_t end = std::min< size_t >( n , (b+1)*blockSize );
+							for( size_t i=b*blockSize ; i<end ; i++ ) histogram[ Digit( data[i] ) ]++;
+						} ,
+						ThreadPool::NumThreads() , ThreadPool::ParallelizationType , ThreadPool::ScheduleType::STATIC , 1
+					);
+
+				// Skip the pass if all the keys share the same digit
+				{
+					bool skip = false;
+					for( size_t r=0 ; r<Radix && !skip ; r++ )
+					{
+						size_t count = 0;
+						for( size_t b=0 ; b<blocks ; b++ ) count += histograms[ b*Radix + r ];
+						if( count==n ) skip = true;
+						else if( count ) break;
+					}
+					if( skip ) continue;
+				}
+
+				// Transform the histograms into (digit-major) offsets
+				{
+					size_t offset = 0;
+					for( size_t r=0 ; r<Radix ; r++ ) for( size_t b=0 ; b<blocks ; b++ )
+					{
+						size_t count = histograms[ b*Radix + r ];
+						histograms[ b*Radix + r ] = offset;
+						offset += count;
+					}
+				}
+
+				// Scatter
+				ThreadPool::ParallelFor
+					(
+						0 , blocks ,
+						[&]( size_t b )
+						{
+							size_t * offsets = histograms.data() + b*Radix;
+							const size_t end = std::min< size_t >( n , (b+1)*blockSize );
+							for( size_t i=b*blockSize ; i<end ; i++ ) temp[ offsets[ Digit( data[i] ) ]++ ] = data[i];
+						} ,
+						ThreadPool::NumThreads() , ThreadPool::ParallelizationType , ThreadPool::ScheduleType::STATIC , 1
+					);
+				std::swap( data , temp );
+			}
+		}
+	}
+}
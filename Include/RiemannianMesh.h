@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <Eigen/Sparse>
+#include <Misha/MultiThreading.h>
+#include <Misha/Geometry.h>
+#include <Misha/Exceptions.h>
+#include <Misha/Trace.h>
+#include "Mesh.h"
+
+namespace MishaK
+{
+	namespace AdvancedGraphics
+	{
+		// Finite-elements discretization of the Laplace-Beltrami operator over a triangle mesh, using piecewise-linear hat functions
+		namespace RiemannianMesh
+		{
+			// The type of the system matrices
+			using Matrix = Eigen::SparseMatrix< double >;
+
+			// Throws an exception if the mesh has out-of-range vertex indices, triangles with repeated vertices,
+			// zero-area triangles, or edges shared by more than two triangles
+			template< typename Real >
+			void Validate( const MeshT< Real > & mesh );
+
+			// Returns the (consistent) mass matrix, M_{ij} = \int \phi_i \phi_j
+			template< typename Real >
+			Matrix ScalarMass( const MeshT< Real > & mesh );
+
+			// Returns the (cotangent) stiffness matrix, S_{ij} = \int < \nabla \phi_i , \nabla \phi_j >
+			template< typename Real >
+			Matrix ScalarStiffness( const MeshT< Real > & mesh );
+
+			// A structure for (re-)assembling the mass and stiffness matrices of a mesh with fixed connectivity
+			// -- The sparsity pattern (shared by the mass and stiffness matrices) is computed once, at construction
+			// -- For every non-zero entry, the list of (triangle-local) element entries contributing to it is precomputed
+			// -- Assembly computes the element matrices in parallel over the triangles and then sums them into the non-zeros
+			//    in parallel over the columns, so no triplets are sorted and no two threads write to the same entry
+			// [NOTE] The vertex positions may change between assemblies but the triangles may not
+			template< typename Real >
+			struct Assembler
+			{
+				using StorageIndex = typename Matrix::StorageIndex;
+
+				Assembler( const MeshT< Real > & mesh );
+
+				// The number of non-zero entries in the matrices
+				size_t nonZeros( void ) const;
+
+				// Returns true if the matrix has the assembler's sparsity pattern
+				bool hasPattern( const Matrix & M ) const;
+
+				// Returns the matrices
+				Matrix mass( void );
+				Matrix stiffness( void );
+
+				// Sets the matrices
+				// [NOTE] If the matrix already has the assembler's sparsity pattern, only the values are over-written
+				void mass( Matrix & M );
+				void stiffness( Matrix & S );
+
+			protected:
+				const MeshT< Real > & _mesh;
+
+				// The column offsets and row indices of the sparsity pattern
+				std::vector< StorageIndex > _outer , _inner;
+
+				// For each non-zero, the range of contributing element entries
+				std::vector< size_t > _contributionOffsets;
+
+				// The element entries, indexed as 9*t + 3*i + j for the (i,j)-th entry of the t-th triangle's element matrix
+				std::vector< size_t > _contributions;
+
+				// The element matrices
+				std::vector< double > _elements;
+
+				template< typename ElementFunctor /* = std::function< void ( Point< double , 3 > [3] , double [3][3] ) > */ >
+				void _assemble( Matrix & M , ElementFunctor F );
+
+				static void _MassElement( const Point< double , 3 > p[3] , double m[3][3] );
+				static void _StiffnessElement( const Point< double , 3 > p[3] , double s[3][3] );
+			};
+		}
+
+#include "RiemannianMesh.inl"
+	}
+}
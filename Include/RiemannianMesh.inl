@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+////////////////////
+// RiemannianMesh //
+////////////////////
+
+template< typename Real >
+void RiemannianMesh::Validate( const MeshT< Real > & mesh )
+{
+	const size_t vNum = mesh.vertices.size();
+	std::vector< unsigned long long > edgeKeys;
+	edgeKeys.reserve( mesh.triangles.size()*3 );
+
+	for( size_t t=0 ; t<mesh.triangles.size() ; t++ )
+	{
+		const SimplexIndex< 2 > & tri = mesh.triangles[t];
+		for( unsigned int k=0 ; k<3 ; k++ ) if( tri[k]>=vNum ) MK_THROW( "Vertex index out of range in triangle " , t , ": " , tri[k] , " >= " , vNum );
+		for( unsigned int k=0 ; k<3 ; k++ ) if( tri[k]==tri[(k+1)%3] ) MK_THROW( "Repeated vertex in triangle " , t , ": " , tri[k] );
+
+		Point< double , 3 > p[] = { Point< double , 3 >( mesh.vertices[ tri[0] ] ) , Point< double , 3 >( mesh.vertices[ tri[1] ] ) , Point< double , 3 >( mesh.vertices[ tri[2] ] ) };
+		if( !Point< double , 3 >::SquareNorm( Point< double , 3 >::CrossProduct( p[1]-p[0] , p[2]-p[0] ) ) ) MK_THROW( "Zero-area triangle: " , t );
+
+		for( unsigned int k=0 ; k<3 ; k++ )
+		{
+			unsigned long long v1 = tri[k] , v2 = tri[(k+1)%3];
+			if( v1>v2 ) std::swap( v1 , v2 );
+			edgeKeys.push_back( ( v1<<32 ) | v2 );
+		}
+	}
+
+	std::sort( edgeKeys.begin() , edgeKeys.end() );
+	for( size_t i=0 ; i+2<edgeKeys.size() ; i++ ) if( edgeKeys[i]==edgeKeys[i+2] )
+		MK_THROW( "Non-manifold edge: ( " , edgeKeys[i]>>32 , " , " , edgeKeys[i] & 0xffffffff , " )" );
+}
+
+template< typename Real >
+RiemannianMesh::Matrix RiemannianMesh::ScalarMass( const MeshT< Real > & mesh ){ return Assembler< Real >( mesh ).mass(); }
+
+template< typename Real >
+RiemannianMesh::Matrix RiemannianMesh::ScalarStiffness( const MeshT< Real > & mesh ){ return Assembler< Real >( mesh ).stiffness(); }
+
+///////////////////////////////
+// RiemannianMesh::Assembler //
+///////////////////////////////
+
+template< typename Real >
+RiemannianMesh::Assembler< Real >::Assembler( const MeshT< Real > & mesh ) : _mesh(mesh)
+{
+	MK_TRACE_SCOPE( "RiemannianMesh::Assembler::Assembler" );
+	const size_t vNum = _mesh.vertices.size() , tNum = _mesh.triangles.size();
+	if( vNum>static_cast< size_t >( std::numeric_limits< StorageIndex >::max() ) ) MK_THROW( "Too many vertices for the storage index: " , vNum );
+
+	// Compute the triangles incident on each vertex, encoded as 3*t + k for the k-th corner of the t-th triangle
+	std::vector< size_t > incidentOffsets( vNum+1 , 0 ) , incident( 3*tNum );
+	for( size_t t=0 ; t<tNum ; t++ ) for( unsigned int k=0 ; k<3 ; k++ )
+	{
+		if( _mesh.triangles[t][k]>=vNum ) MK_THROW( "Vertex index out of range: " , _mesh.triangles[t][k] , " >= " , vNum );
+		incidentOffsets[ _mesh.triangles[t][k]+1 ]++;
+	}
+	ThreadPool::ParallelScan< size_t >( 0 , vNum , [&]( size_t v ){ return incidentOffsets[v+1]; } , [&]( size_t v , size_t o ){ incidentOffsets[v+1] = o; } , ThreadPool::ScanType::INCLUSIVE );
+	{
+		std::vector< size_t > counts( incidentOffsets.begin() , incidentOffsets.end()-1 );
+		for( size_t t=0 ; t<tNum ; t++ ) for( unsigned int k=0 ; k<3 ; k++ ) incident[ counts[ _mesh.triangles[t][k] ]++ ] = 3*t+k;
+	}
+
+	// For each column, the (row,element entry) pairs, sorted by row
+	// [NOTE] The column of vertex v occupies the range [ 3*incidentOffsets[v] , 3*incidentOffsets[v+1] )
+	std::vector< std::pair< StorageIndex , size_t > > entries( 9*tNum );
+	std::vector< StorageIndex > columnSizes( vNum );
+	ThreadPool::ParallelFor
+		(
+			0 , vNum ,
+			[&]( size_t v )
+			{
+				std::pair< StorageIndex , size_t > * _entries = entries.data() + 3*incidentOffsets[v];
+				size_t sz = 0;
+				for( size_t i=incidentOffsets[v] ; i<incidentOffsets[v+1] ; i++ )
+				{
+					size_t t = incident[i]/3;
+					unsigned int k = static_cast< unsigned int >( incident[i]%3 );
+					for( unsigned int j=0 ; j<3 ; j++ ) _entries[sz++] = std::make_pair( static_cast< StorageIndex >( _mesh.triangles[t][j] ) , 9*t + 3*j + k );
+				}
+				std::sort( _entries , _entries+sz );
+
+				StorageIndex count = 0;
+				for( size_t i=0 ; i<sz ; i++ ) if( !i || _entries[i].first!=_entries[i-1].first ) count++;
+				columnSizes[v] = count;
+			}
+		);
+
+	_outer.resize( vNum+1 );
+	_outer[vNum] = ThreadPool::ParallelScan< StorageIndex >( 0 , vNum , [&]( size_t v ){ return columnSizes[v]; } , [&]( size_t v , StorageIndex o ){ _outer[v] = o; } , ThreadPool::ScanType::EXCLUSIVE );
+
+	_inner.resize( _outer.back() );
+	_contributionOffsets.resize( _outer.back()+1 );
+	_contributions.resize( 9*tNum );
+	ThreadPool::ParallelFor
+		(
+			0 , vNum ,
+			[&]( size_t v )
+			{
+				const size_t begin = 3*incidentOffsets[v] , end = 3*incidentOffsets[v+1];
+				StorageIndex idx = _outer[v];
+				for( size_t i=begin ; i<end ; i++ )
+				{
+					if( i==begin || entries[i].first!=entries[i-1].first )
+					{
+						_inner[idx] = entries[i].first;
+						_contributionOffsets[idx++] = i;
+					}
+					_contributions[i] = entries[i].second;
+				}
+			}
+		);
+	_contributionOffsets.back() = 9*tNum;
+
+	_elements.resize( 9*tNum );
+}
+
+template< typename Real >
+size_t RiemannianMesh::Assembler< Real >::nonZeros( void ) const { return _inner.size(); }
+
+template< typename Real >
+bool RiemannianMesh::Assembler< Real >::hasPattern( const Matrix & M ) const
+{
+	if( M.rows()!=static_cast< Eigen::Index >( _mesh.vertices.size() ) || M.cols()!=static_cast< Eigen::Index >( _mesh.vertices.size() ) ) return false;
+	if( !M.isCompressed() || static_cast< size_t >( M.nonZeros() )!=_inner.size() ) return false;
+	return std::equal( _outer.begin() , _outer.end() , M.outerIndexPtr() ) && std::equal( _inner.begin() , _inner.end() , M.innerIndexPtr() );
+}
+
+template< typename Real >
+RiemannianMesh::Matrix RiemannianMesh::Assembler< Real >::mass( void )
+{
+	Matrix M;
+	mass( M );
+	return M;
+}
+
+template< typename Real >
+RiemannianMesh::Matrix RiemannianMesh::Assembler< Real >::stiffness( void )
+{
+	Matrix S;
+	stiffness( S );
+	return S;
+}
+
+template< typename Real >
+void RiemannianMesh::Assembler< Real >::mass( Matrix & M ){ _assemble( M , _MassElement ); }
+
+template< typename Real >
+void RiemannianMesh::Assembler< Real >::stiffness( Matrix & S ){ _assemble( S , _StiffnessElement ); }
+
+template< typename Real >
+template< typename ElementFunctor >
+void RiemannianMesh::Assembler< Real >::_assemble( Matrix & M , ElementFunctor F )
+{
+	MK_TRACE_SCOPE( "RiemannianMesh::Assembler::assemble" );
+	// Set the sparsity pattern, if it is not already set
+	if( !hasPattern( M ) )
+	{
+		M.resize( _mesh.vertices.size() , _mesh.vertices.size() );
+		M.resizeNonZeros( static_cast< Eigen::Index >( _inner.size() ) );
+		std::copy( _outer.begin() , _outer.end() , M.outerIndexPtr() );
+		std::copy( _inner.begin() , _inner.end() , M.innerIndexPtr() );
+	}
+
+	// Compute the element matrices
+	ThreadPool::ParallelFor
+		(
+			0 , _mesh.triangles.size() ,
+			[&]( size_t t )
+			{
+				Point< double , 3 > p[3];
+				for( unsigned int k=0 ; k<3 ; k++ ) p[k] = Point< double , 3 >( _mesh.vertices[ _mesh.triangles[t][k] ] );
+				F( p , reinterpret_cast< double (*)[3] >( _elements.data() + 9*t ) );
+			}
+		);
+
+	// Gather the element entries into the non-zeros
+	double * values = M.valuePtr();
+	ThreadPool::ParallelFor
+		(
+			0 , _mesh.vertices.size() ,
+			[&]( size_t v )
+			{
+				for( StorageIndex i=_outer[v] ; i<_outer[v+1] ; i++ )
+				{
+					double value = 0;
+					for( size_t j=_contributionOffsets[i] ; j<_contributionOffsets[i+1] ; j++ ) value += _elements[ _contributions[j] ];
+					values[i] = value;
+				}
+			}
+		);
+}
+
+template< typename Real >
+void RiemannianMesh::Assembler< Real >::_MassElement( const Point< double , 3 > p[3] , double m[3][3] )
+{
+	double area = Point< double , 3 >::Length( Point< double , 3 >::CrossProduct( p[1]-p[0] , p[2]-p[0] ) ) / 2.;
+	for( unsigned int i=0 ; i<3 ; i++ ) for( unsigned int j=0 ; j<3 ; j++ ) m[i][j] = i==j ? area/6. : area/12.;
+}
+
+template< typename Real >
+void RiemannianMesh::Assembler< Real >::_StiffnessElement( const Point< double , 3 > p[3] , double s[3][3] )
+{
+	for( unsigned int i=0 ; i<3 ; i++ ) s[i][i] = 0;
+	for( unsigned int k=0 ; k<3 ; k++ )
+	{
+		// The edge opposite the k-th corner is weighted by half the cotangent of the corner's angle
+		unsigned int i = (k+1)%3 , j = (k+2)%3;
+		Point< double , 3 > e1 = p[i]-p[k] , e2 = p[j]-p[k];
+		double doubleArea = Point< double , 3 >::Length( Point< double , 3 >::CrossProduct( e1 , e2 ) );
+		double w = doubleArea ? Point< double , 3 >::Dot( e1 , e2 ) / doubleArea / 2. : 0.;
+		s[i][j] = s[j][i] = -w;
+		s[i][i] += w , s[j][j] += w;
+	}
+}
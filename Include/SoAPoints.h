@@ -0,0 +1,140 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+
+#pragma once
+
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <Misha/Geometry.h>
+#include <Misha/MultiThreading.h>
+
+namespace MishaK
+{
+	namespace AdvancedGraphics
+	{
+		// An STL allocator returning memory aligned to the prescribed number of bytes
+		template< typename T , size_t Alignment >
+		struct AlignedAllocator
+		{
+			static_assert( Alignment>=alignof(T) && !( Alignment & (Alignment-1) ) , "[ERROR] Alignment must be a power of two no smaller than the type's alignment" );
+			using value_type = T;
+			template< typename U > struct rebind{ using other = AlignedAllocator< U , Alignment >; };
+
+			AlignedAllocator( void ){}
+			template< typename U > AlignedAllocator( const AlignedAllocator< U , Alignment > & ){}
+
+			T * allocate( size_t n ){ return static_cast< T * >( ::operator new( n * sizeof(T) , std::align_val_t( Alignment ) ) ); }
+			void deallocate( T * p , size_t ){ ::operator delete( p , std::align_val_t( Alignment ) ); }
+
+			template< typename U > bool operator == ( const AlignedAllocator< U , Alignment > & ) const { return true; }
+			template< typename U > bool operator != ( const AlignedAllocator< U , Alignment > & ) const { return false; }
+		};
+
+		// A structure-of-arrays representation of a set of points, with the d-th coordinates of all the points stored contiguously.
+		// -- Each coordinate array starts on an Alignment-byte boundary and its length is padded to a multiple of Alignment bytes
+		// -- The padding entries are zero, so kernels can process full-width vectors without a remainder loop
+		template< typename Real , unsigned int Dim >
+		struct SoAPoints
+		{
+			// The alignment (in bytes) of the coordinate arrays, sufficient for AVX-512 loads
+			static const size_t Alignment = 64;
+
+			// The number of entries the lengths of the coordinate arrays are rounded up to
+			static const size_t Padding = Alignment / sizeof( Real );
+
+			SoAPoints( void ) : _size(0) , _paddedSize(0) {}
+			SoAPoints( const std::vector< Point< Real , Dim > > & points ) : SoAPoints() { set( points ); }
+
+			// The number of points
+			size_t size( void ) const { return _size; }
+
+			// The (padded) length of each coordinate array
+			size_t paddedSize( void ) const { return _paddedSize; }
+
+			// Resizes the arrays, setting all the coordinates to zero
+			void resize( size_t size );
+
+			// Returns a pointer to the (aligned) array of d-th coordinates
+			Real * operator[]( unsigned int d ){ return _coordinates.data() + d*_paddedSize; }
+			const Real * operator[]( unsigned int d ) const { return _coordinates.data() + d*_paddedSize; }
+
+			// Returns the i-th point
+			Point< Real , Dim > operator()( size_t i ) const;
+
+			// Sets the i-th point
+			void set( size_t i , Point< Real , Dim > p );
+
+			// Sets the arrays from the points
+			void set( const std::vector< Point< Real , Dim > > & points );
+
+			// Writes the arrays back into the points (resizing as necessary)
+			void get( std::vector< Point< Real , Dim > > & points ) const;
+
+		protected:
+			size_t _size , _paddedSize;
+			std::vector< Real , AlignedAllocator< Real , Alignment > > _coordinates;
+		};
+
+		///////////////
+		// SoAPoints //
+		///////////////
+		template< typename Real , unsigned int Dim >
+		void SoAPoints< Real , Dim >::resize( size_t size )
+		{
+			_size = size;
+			_paddedSize = ( ( size + Padding - 1 ) / Padding ) * Padding;
+			_coordinates.assign( Dim * _paddedSize , static_cast< Real >(0) );
+		}
+
+		template< typename Real , unsigned int Dim >
+		Point< Real , Dim > SoAPoints< Real , Dim >::operator()( size_t i ) const
+		{
+			Point< Real , Dim > p;
+			for( unsigned int d=0 ; d<Dim ; d++ ) p[d] = operator[](d)[i];
+			return p;
+		}
+
+		template< typename Real , unsigned int Dim >
+		void SoAPoints< Real , Dim >::set( size_t i , Point< Real , Dim > p ){ for( unsigned int d=0 ; d<Dim ; d++ ) operator[](d)[i] = p[d]; }
+
+		template< typename Real , unsigned int Dim >
+		void SoAPoints< Real , Dim >::set( const std::vector< Point< Real , Dim > > & points )
+		{
+			resize( points.size() );
+			ThreadPool::ParallelFor( 0 , points.size() , [&]( size_t i ){ set( i , points[i] ); } );
+		}
+
+		template< typename Real , unsigned int Dim >
+		void SoAPoints< Real , Dim >::get( std::vector< Point< Real , Dim > > & points ) const
+		{
+			points.resize( _size );
+			ThreadPool::ParallelFor( 0 , _size , [&]( size_t i ){ points[i] = operator()( i ); } );
+		}
+	}
+}
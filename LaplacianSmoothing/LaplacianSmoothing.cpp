@@ -36,19 +36,23 @@ using namespace MishaK::AdvancedGraphics;
 
 CmdLineParameter< std::string >
 	In( "in" ) , 
-	Transform( "xForm" );
+	Transform( "xForm" ) ,
+	Solver( "solver" , "direct" );
 
 CmdLineParameter< unsigned int >
 	Width( "width" , 640 ) ,
-	Height( "height" , 480 );
+	Height( "height" , 480 ) ,
+	Iterations( "iters" , 1000 );
 
 CmdLineParameter< double >
-	StepSize( "stepSize" , 1e-4 );
+	StepSize( "stepSize" , 1e-4 ) ,
+	Tolerance( "tolerance" , 1e-8 );
 
 CmdLineReadable
 	GouraudShading( "gouraud" ) ,
 	UpdateMass( "updateMass" ) ,
 	UpdateStiffness( "updateStiffness" ) ,
+	SmoothAttributes( "smoothAttributes" ) ,
 	Normalize( "normalize" );
 
 std::vector< CmdLineReadable* > params =
@@ -58,9 +62,13 @@ std::vector< CmdLineReadable* > params =
 	&Width ,
 	&Height ,
 	&StepSize ,
+	&Solver ,
+	&Tolerance ,
+	&Iterations ,
 	&GouraudShading ,
 	&UpdateMass ,
 	&UpdateStiffness ,
+	&SmoothAttributes ,
 	&Normalize ,
 };
 
@@ -72,9 +80,13 @@ void ShowUsage( std::string ex )
 	std::cout << "\t[--" << Width.name << " <width> = " << Width.value << "]" << std::endl;
 	std::cout << "\t[--" << Height.name << " <height> = " << Height.value << "]" << std::endl;
 	std::cout << "\t[--" << StepSize.name << " <step-size> = " << StepSize.value << "]" << std::endl;
+	std::cout << "\t[--" << Solver.name << " <solver type: direct/jacobi/ichol/multigrid> = " << Solver.value << "]" << std::endl;
+	std::cout << "\t[--" << Tolerance.name << " <iterative solver tolerance> = " << Tolerance.value << "]" << std::endl;
+	std::cout << "\t[--" << Iterations.name << " <maximum iterative solver iterations> = " << Iterations.value << "]" << std::endl;
 	std::cout << "\t[--" << GouraudShading.name << "]" << std::endl;
 	std::cout << "\t[--" << UpdateMass.name << "]" << std::endl;
 	std::cout << "\t[--" << UpdateStiffness.name << "]" << std::endl;
+	std::cout << "\t[--" << SmoothAttributes.name << "]" << std::endl;
 	std::cout << "\t[--" << Normalize.name << "]" << std::endl;
 }
 
@@ -84,30 +96,53 @@ struct LaplacianSmoothingViewer : public DynamicMeshViewer
 	double stepSize;
 	bool updateMass , updateStiffness;
 
-	LaplacianSmoothingViewer( Mesh & mesh , double stepSize , DynamicMeshViewer::Parameters parameters , bool normalize )
+	// Should the values and colors be smoothed along with the geometry
+	bool smoothAttributes;
+
+	LaplacianSmoothingViewer( Mesh & mesh , double stepSize , DynamicMeshViewer::Parameters parameters , bool normalize , SystemSolver::Type solverType , double tolerance , unsigned int maxIterations )
 		: DynamicMeshViewer( mesh , parameters )
 		, _mesh(mesh)
 		, stepSize(stepSize)
 		, updateMass(false)
 		, updateStiffness(false)
+		, smoothAttributes(false)
 		, _normalize(normalize)
+		, _assembler(mesh)
+		, _solver( solverType , tolerance , maxIterations )
 	{
 		_stepSizeIndex = static_cast< unsigned int >( info.size() );
 		info.resize( info.size()+1 );
 		info.back() = std::string( "Step-size:" ) + std::to_string( stepSize );
 
-		_mass = RiemannianMesh::ScalarMass( _mesh );
-		_stiffness = RiemannianMesh::ScalarStiffness( _mesh );
+		// The connectivity does not change so the sparsity pattern is only computed once
+		_assembler.mass( _mass );
+		_assembler.stiffness( _stiffness );
 
 		Miscellany::PerformanceMeter pMeter( '.' );
 
-		////////////////////////////////////////////
-		// [IMPLEMENT SOLVER INITIALIZATION HERE] //
-		MK_WARN_ONCE( "Solver not initialized" );
-		////////////////////////////////////////////
+		// The symbolic analysis is performed once, subsequent updates only refill the numerical factorization
+		_setSystemMatrix();
+		_solver.compute( _system );
 
 		if( _solver.info()!=Eigen::Success ) MK_ERROR_OUT( "Failed to factorize matrix" );
 		std::cout << pMeter( "Factorized" ) << std::endl;
+		std::cout << "\tSymbolic / numerical: " << _solver.analysisTime() << " / " << _solver.factorizationTime() << " (s)" << std::endl;
+		if( _solver.type()==SystemSolver::PCG_MULTIGRID )
+		{
+			std::cout << "\tMultigrid levels:";
+			for( size_t l=0 ; l<_solver.multigrid().levels() ; l++ ) std::cout << " " << _solver.multigrid().size(l);
+			std::cout << std::endl;
+		}
+
+		_factorizationIndex = static_cast< unsigned int >( info.size() );
+		info.resize( info.size()+1 );
+		_setFactorizationInfo();
+
+		if( _solver.iterative() )
+		{
+			_solveIndex = static_cast< unsigned int >( info.size() );
+			info.resize( info.size()+1 );
+		}
 
 		addCallBack( ']' , "increase step-size" , &LaplacianSmoothingViewer::_increaseStepSizeCallBack );
 		addCallBack( '[' , "decrease step-size" , &LaplacianSmoothingViewer::_decreaseStepSizeCallBack );
@@ -119,19 +154,34 @@ struct LaplacianSmoothingViewer : public DynamicMeshViewer
 		{
 			if( updateMass || updateStiffness )
 			{
-				if( updateMass ) _mass = RiemannianMesh::ScalarMass( _mesh );
-				if( updateStiffness ) _stiffness = RiemannianMesh::ScalarStiffness( _mesh );
+				// Over-write the values of the existing non-zeros
+				if( updateMass ) _assembler.mass( _mass );
+				if( updateStiffness ) _assembler.stiffness( _stiffness );
 				_updateNumericalFactorization();
 				if( _solver.info()!=Eigen::Success ) MK_ERROR_OUT( "Failed to factorize matrix" );
 			}
 
-			Eigen::VectorXd x( _mesh.vertices.size() );
-			for( unsigned int d=0 ; d<3 ; d++ )
+			// Solve for the coordinates (and, if requested, the values and color channels) at once, with a single pass over the factor
+			// [NOTE] The current values also serve as the initial guess for the iterative solvers
+			const bool smoothValues = smoothAttributes && _mesh.values.size() , smoothColors = smoothAttributes && _mesh.colors.size();
+			_x.resize( _mesh.vertices.size() , 3 + ( smoothValues ? 1 : 0 ) + ( smoothColors ? 3 : 0 ) );
+			Eigen::Index c = 0;
+			_x.middleCols( c , 3 ) = _mesh.vertexMap() , c += 3;
+			if( smoothValues ) _x.col( c ) = _mesh.valueMap() , c++;
+			if( smoothColors ) _x.middleCols( c , 3 ) = _mesh.colorMap() , c += 3;
+
+			_rhs.noalias() = _mass * _x;
+			_solver.solveWithGuess( _rhs , _x );
+			if( _solver.iterative() )
 			{
-				for( unsigned int i=0 ; i<_mesh.vertices.size() ; i++ ) x[i] = _mesh.vertices[i][d];
-				x = _solver.solve( _mass * x );
-				for( unsigned int i=0 ; i<_mesh.vertices.size() ; i++ ) _mesh.vertices[i][d] = x[i];
+				if( _solver.info()!=Eigen::Success ) MK_WARN( "Solver did not converge: " , _solver.error() );
+				info[ _solveIndex ] = std::string( "Iterations / residual: " ) + std::to_string( _solver.iterations() ) + std::string( " / " ) + std::to_string( _solver.error() );
 			}
+
+			c = 0;
+			_mesh.vertexMap() = _x.middleCols( c , 3 ) , c += 3;
+			if( smoothValues ) _mesh.valueMap() = _x.col( c ) , c++;
+			if( smoothColors ) _mesh.colorMap() = _x.middleCols( c , 3 ) , c += 3;
 		}
 		if( _normalize ) _mesh.normalize();
 		visualizationNeedsUpdating();
@@ -139,10 +189,12 @@ struct LaplacianSmoothingViewer : public DynamicMeshViewer
 
 protected:
 	bool _normalize;
-	unsigned int _stepSizeIndex;
+	unsigned int _stepSizeIndex , _factorizationIndex , _solveIndex;
 	Mesh & _mesh;
-	Eigen::SparseMatrix< double > _mass , _stiffness;
-	LDLtSolver _solver;
+	RiemannianMesh::Assembler< double > _assembler;
+	Eigen::SparseMatrix< double > _mass , _stiffness , _system;
+	Eigen::Matrix< double , Eigen::Dynamic , Eigen::Dynamic , Eigen::RowMajor > _x , _rhs;
+	SystemSolver _solver;
 
 	void _decreaseStepSizeCallBack( std::string )
 	{
@@ -158,14 +210,26 @@ protected:
 		_updateNumericalFactorization();
 	}
 
-	void _updateNumericalFactorization( void )
+	// Sets the system matrix M + stepSize * S
+	// [NOTE] The mass and stiffness matrices share their sparsity pattern, so only the values need to be combined
+	void _setSystemMatrix( void )
 	{
+		if( _system.nonZeros()!=_mass.nonZeros() ) _system = _mass;
+		const Eigen::Index nnz = _mass.nonZeros();
+		Eigen::Map< Eigen::VectorXd >( _system.valuePtr() , nnz ) = Eigen::Map< const Eigen::VectorXd >( _mass.valuePtr() , nnz ) + Eigen::Map< const Eigen::VectorXd >( _stiffness.valuePtr() , nnz ) * stepSize;
+	}
 
-		/////////////////////////////////////////////////////
-		// [IMPLEMENT NUMERICAL_FACTORIZATION UPDATE HERE] //
-		MK_WARN_ONCE( "Numerical factorization update not implemented" );
-		/////////////////////////////////////////////////////
+	void _setFactorizationInfo( void )
+	{
+		info[ _factorizationIndex ] = std::string( _solver.iterative() ? "Preconditioner symbolic / numerical (ms): " : "Symbolic / numerical (ms): " ) + std::to_string( _solver.analysisTime()*1000. ) + std::string( " / " ) + std::to_string( _solver.factorizationTime()*1000. );
+	}
 
+	void _updateNumericalFactorization( void )
+	{
+		// The sparsity pattern is unchanged so only the numerical factorization is re-computed
+		_setSystemMatrix();
+		_solver.refactorize( _system );
+		_setFactorizationInfo();
 	}
 };
 
@@ -178,7 +242,7 @@ int main( int argc , char* argv[] )
 		return EXIT_FAILURE;
 	}
 
-	DynamicMeshViewer::OutputMouseInterfaceControls( std::cout , true );
+	DynamicMeshViewer::OutputMouseInterfaceControls( std::cout );
 
 	Mesh mesh( In.value );
 
@@ -205,15 +269,20 @@ int main( int argc , char* argv[] )
 	// So that the results of the comptuation do not depend on the scale, normalize
 	mesh.normalize();
 
+	unsigned int solverType = 0;
+	while( solverType<SystemSolver::TypeNames.size() && SystemSolver::TypeNames[solverType]!=Solver.value ) solverType++;
+	if( solverType==SystemSolver::TypeNames.size() ) MK_THROW( "Unrecognized solver type: " , Solver.value );
+
 	DynamicMeshViewer::Parameters parameters;
 	parameters.flatShading = !GouraudShading.set;
 	parameters.selectionType = DynamicMeshViewer::SelectionType::NONE;
-	LaplacianSmoothingViewer v( mesh , StepSize.value , parameters , Normalize.set );
+	LaplacianSmoothingViewer v( mesh , StepSize.value , parameters , Normalize.set , static_cast< SystemSolver::Type >( solverType ) , Tolerance.value , Iterations.value );
 
 	v.screenWidth = Width.value;
 	v.screenHeight = Height.value;
 	v.updateMass = UpdateMass.set;
 	v.updateStiffness = UpdateStiffness.set;
+	v.smoothAttributes = SmoothAttributes.set;
 	if( Transform.set ) v.readXForm( Transform.value );
 
 	LaplacianSmoothingViewer::Viewer::Run( &v , argc , argv , "Laplacian Smoothing: " + In.value );
@@ -31,14 +31,15 @@ DAMAGE.
 #include <Misha/CmdLineParser.h>
 #include <Misha/Geometry.h>
 #include "DynamicMeshViewer.h"
-#include <set>
+#include "OneRingAverager.h"
 
 using namespace MishaK;
 using namespace MishaK::AdvancedGraphics;
 
 CmdLineParameter< std::string >
 	In( "in" ) , 
-	Transform( "xForm" );
+	Transform( "xForm" ) ,
+	Reorder( "reorder" );
 
 CmdLineParameter< unsigned int >
 	Width( "width" , 640 ) ,
@@ -51,19 +52,22 @@ CmdLineReadable
 	GouraudShading( "gouraud" ) ,
 	PointSelection( "pointSelection" ) ,
 	UpdateBoundingBox( "updateBBox" ) ,
-	SmoothGeometry( "geometry" );
+	SmoothGeometry( "geometry" ) ,
+	SinglePrecision( "float" );
 
 std::vector< CmdLineReadable* > params =
 {
 	&In ,
 	&Transform ,
+	&Reorder ,
 	&Width ,
 	&Height ,
 	&SourceAmplitude ,
 	&GouraudShading ,
 	&PointSelection ,
 	&UpdateBoundingBox ,
-	&SmoothGeometry
+	&SmoothGeometry ,
+	&SinglePrecision
 };
 
 void ShowUsage( std::string ex )
@@ -71,6 +75,7 @@ void ShowUsage( std::string ex )
 	std::cout << "Usage: " << ex << std::endl;
 	std::cout << "\t --" << In.name << " <input geometry>" << std::endl;
 	std::cout << "\t[--" << Transform.name << " <transform>]" << std::endl;
+	std::cout << "\t[--" << Reorder.name << " <vertex reordering: morton/rcm>]" << std::endl;
 	std::cout << "\t[--" << Width.name << " <width> = " << Width.value << "]" << std::endl;
 	std::cout << "\t[--" << Height.name << " <height> = " << Height.value << "]" << std::endl;
 	std::cout << "\t[--" << SourceAmplitude.name << " <source ampitude> = " << SourceAmplitude.value << "]" << std::endl;
@@ -78,84 +83,40 @@ void ShowUsage( std::string ex )
 	std::cout << "\t[--" << GouraudShading.name << "]" << std::endl;
 	std::cout << "\t[--" << UpdateBoundingBox.name << "]" << std::endl;
 	std::cout << "\t[--" << SmoothGeometry.name << "]" << std::endl;
+	std::cout << "\t[--" << SinglePrecision.name << "]" << std::endl;
 }
 
-struct OneRingSmoothingViewer : public DynamicMeshViewer
+template< typename Real >
+struct OneRingSmoothingViewer : public DynamicMeshViewerT< Real >
 {
+	using DynamicMeshViewerT< Real >::visualizationNeedsUpdating;
+
 	// The strength of the source at selected vertices (for signal averaging)
 	double sourceAmplitude;
 
-	OneRingSmoothingViewer( Mesh & mesh , bool smoothSignal , double sourceAmplitude , DynamicMeshViewer::Parameters parameters )
-		: DynamicMeshViewer( mesh , parameters )
+	OneRingSmoothingViewer( MeshT< Real > & mesh , bool smoothSignal , double sourceAmplitude , typename DynamicMeshViewerT< Real >::Parameters parameters )
+		: DynamicMeshViewerT< Real >( mesh , parameters )
 		, _smoothSignal(smoothSignal)
 		, _mesh(mesh)
 		, sourceAmplitude(sourceAmplitude)
-	{}
+		, _averager(mesh)
+	{
+		// The connectivity does not change so the adjacency is only computed once
+		_mesh.setAdjacency();
+
+		// When smoothing the geometry, the positions are updated through the structure-of-arrays representation
+		if( !_smoothSignal ) _mesh.setSoAVertices();
+	}
 
 	// Performs the averaging of the geometry/signal
 	void animate( void )
 	{
-		// build adjacency list for now 
-		std::vector<std::set<unsigned int>> neighbors(_mesh.vertices.size());
-		for (auto triangle : _mesh.triangles) {
-			neighbors[triangle[0]].insert({triangle[1], triangle[2]});
-			neighbors[triangle[1]].insert({triangle[0], triangle[2]});
-			neighbors[triangle[2]].insert({triangle[0], triangle[1]});
-		}
-
 		// set lambda
 		double lambda = 1;
 
-		if( _smoothSignal )
-		{
-			// update the values
-			std::vector<double> nextValues(_mesh.values.size());
-
-			for (int i = 0; i < _mesh.values.size(); i++) {
-				double summed = 0;
-
-				// sum up all the adjacents
-				for (const unsigned int& neighbor: neighbors[i]) {
-					summed += _mesh.values[neighbor];
-				}
-
-				// average it out and subtract mesh value to find delta phi
-				double avg = summed / neighbors[i].size();
-				nextValues[i] = _mesh.values[i] + lambda * (avg - _mesh.values[i]);
-			}
-			_mesh.values = nextValues;
-			
-		}
-		else
-		{
-			// update the vertices
-			std::vector< Point< double , (unsigned int)3U >> nextVertices(_mesh.vertices.size());
-
-
-			for (int i = 0; i < _mesh.vertices.size(); i++) {
-				double summed_x = 0;
-				double summed_y = 0;
-				double summed_z = 0;
-
-				// sum up all the adjacents
-				for (const unsigned int& neighbor: neighbors[i]) {
-					summed_x += _mesh.vertices[neighbor][0];
-					summed_y += _mesh.vertices[neighbor][1];
-					summed_z += _mesh.vertices[neighbor][2];
-				}
-
-				// average it out and subtract mesh value to find delta phi
-				double avg_x = summed_x / (double) neighbors[i].size();
-				double avg_y = summed_y / (double) neighbors[i].size();
-				double avg_z = summed_z / (double) neighbors[i].size();
-
-				nextVertices[i][0] = _mesh.vertices[i][0] + lambda * (avg_x - _mesh.vertices[i][0]);
-				nextVertices[i][1] = _mesh.vertices[i][1] + lambda * (avg_y - _mesh.vertices[i][1]);
-				nextVertices[i][2] = _mesh.vertices[i][2] + lambda * (avg_z - _mesh.vertices[i][2]);
-			}
-			_mesh.vertices = nextVertices;
-
-		}
+		// [NOTE] The viewer reads the positions through the structure-of-arrays representation, so the vertices are not synchronized every frame
+		if( _smoothSignal ) _averager.average( _mesh.values , lambda );
+		else                _averager.average( _mesh.soaVertices , lambda );
 		visualizationNeedsUpdating();
 	}
 
@@ -199,21 +160,14 @@ struct OneRingSmoothingViewer : public DynamicMeshViewer
 
 protected:
 	bool _smoothSignal;
-	Mesh & _mesh;
+	MeshT< Real > & _mesh;
+	OneRingAverager< Real > _averager;
 };
 
-int main( int argc , char* argv[] )
+template< typename Real >
+void Execute( int argc , char* argv[] )
 {
-	CmdLineParse( argc-1 , argv+1 , params );
-	if( !In.set )
-	{
-		ShowUsage( argv[0] );
-		return EXIT_FAILURE;
-	}
-
-	DynamicMeshViewer::OutputMouseInterfaceControls( std::cout );
-	
-	Mesh mesh( In.value );
+	MeshT< Real > mesh( In.value );
 	bool hasColor = false;
 	if( mesh.colors.size() )
 	{
@@ -221,30 +175,59 @@ int main( int argc , char* argv[] )
 		else
 		{
 			mesh.values.resize( mesh.colors.size() );
-			for( unsigned int i=0 ; i<mesh.values.size() ; i++ ) mesh.values[i] = Point< double , 3 >::Dot( mesh.colors[i] , Point< double , 3 >( 1./3 , 1./3 , 1./3 ) ) / 255.;
+			for( unsigned int i=0 ; i<mesh.values.size() ; i++ ) mesh.values[i] = static_cast< Real >( Point< double , 3 >::Dot( mesh.colors[i] , Point< double , 3 >( 1./3 , 1./3 , 1./3 ) ) / 255. );
 			hasColor = true;
 		}
 	}
 	std::cout << "Vertices / Triangles: " << mesh.vertices.size() << " / " << mesh.triangles.size() << std::endl;
 
+	if( Reorder.set )
+	{
+		unsigned int type = 0;
+		while( type<MeshT< Real >::ReorderTypeNames.size() && MeshT< Real >::ReorderTypeNames[type]!=Reorder.value ) type++;
+		if( type==MeshT< Real >::ReorderTypeNames.size() ) MK_THROW( "Unrecognized reorder type: " , Reorder.value );
+
+		size_t bandwidth = mesh.bandwidth() , profile = mesh.profile();
+		Miscellany::PerformanceMeter pMeter( '.' );
+		mesh.reorder( static_cast< typename MeshT< Real >::ReorderType >( type ) );
+		std::cout << pMeter( "Reordered" ) << std::endl;
+		std::cout << "Bandwidth: " << bandwidth << " -> " << mesh.bandwidth() << std::endl;
+		std::cout << "Profile: " << profile << " -> " << mesh.profile() << std::endl;
+	}
+
 	if( !SmoothGeometry.set && !mesh.values.size() )
 	{
 		mesh.values.resize( mesh.vertices.size() );
 		for( unsigned int i=0 ; i<mesh.vertices.size() ; i++ ) mesh.values[i] = 0;
 	}
 
-	DynamicMeshViewer::Parameters parameters;
+	typename DynamicMeshViewerT< Real >::Parameters parameters;
 	parameters.flatShading = !GouraudShading.set;
-	parameters.selectionType = SmoothGeometry.set ? DynamicMeshViewer::SelectionType::NONE : ( PointSelection.set ?  DynamicMeshViewer::SelectionType::CLICK : DynamicMeshViewer::SelectionType::DRAG );
+	parameters.selectionType = SmoothGeometry.set ? DynamicMeshViewerT< Real >::SelectionType::NONE : ( PointSelection.set ?  DynamicMeshViewerT< Real >::SelectionType::CLICK : DynamicMeshViewerT< Real >::SelectionType::DRAG );
 	if( hasColor ) parameters.grayScale = true;
 	else           parameters.valueNormalizationFunction = []( double v ){ return ( v + 1. ) / 2.; };
-	OneRingSmoothingViewer v( mesh , !SmoothGeometry.set , SourceAmplitude.value , parameters );
+	OneRingSmoothingViewer< Real > v( mesh , !SmoothGeometry.set , SourceAmplitude.value , parameters );
 
 	v.screenWidth = Width.value;
 	v.screenHeight = Height.value;
 	v.updateBoundingBox = UpdateBoundingBox.set;
 	if( Transform.set ) v.readXForm( Transform.value );
 
-	OneRingSmoothingViewer::Viewer::Run( &v , argc , argv , "One-Ring Smoothing: " + In.value );
+	OneRingSmoothingViewer< Real >::Viewer::Run( &v , argc , argv , "One-Ring Smoothing: " + In.value );
+}
+
+int main( int argc , char* argv[] )
+{
+	CmdLineParse( argc-1 , argv+1 , params );
+	if( !In.set )
+	{
+		ShowUsage( argv[0] );
+		return EXIT_FAILURE;
+	}
+
+	DynamicMeshViewer::OutputMouseInterfaceControls( std::cout );
+
+	if( SinglePrecision.set ) Execute< float >( argc , argv );
+	else                      Execute< double >( argc , argv );
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
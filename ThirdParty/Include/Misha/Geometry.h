@@ -1235,7 +1235,18 @@ namespace MishaK
 			Index key1 , key2;
 			_EdgeKey( Index k1=0 , Index k2=0 ) : key1(k1) , key2(k2) {}
 			bool operator == ( const _EdgeKey &key ) const  { return key1==key.key1 && key2==key.key2; }
-			struct Hasher{ size_t operator()( const _EdgeKey &key ) const { return (size_t)( key.key1 * key.key2 ); } };
+			// Mix the packed keys (rather than multiplying them) so that edges sharing an end-point do not collide
+			struct Hasher
+			{
+				size_t operator()( const _EdgeKey &key ) const
+				{
+					unsigned long long h = ( static_cast< unsigned long long >( key.key1 )<<32 ) ^ static_cast< unsigned long long >( key.key2 );
+					h ^= h>>33 , h *= 0xff51afd7ed558ccdULL;
+					h ^= h>>33 , h *= 0xc4ceb9fe1a85ec53ULL;
+					h ^= h>>33;
+					return static_cast< size_t >( h );
+				}
+			};
 		};
 		std::unordered_map< _EdgeKey , Index , typename _EdgeKey::Hasher > _edgeTable;
 	public:
@@ -1243,12 +1254,7 @@ namespace MishaK
 		Index &operator()( Index v1 , Index v2 , InitializationFunction &initializationFunction )
 		{
 			auto iter = _edgeTable.find( _EdgeKey(v1,v2) );
-			if( iter==_edgeTable.end() )
-			{
-				Index idx = initializationFunction();
-				_edgeTable[ EdgeKey(v1,v2) ] = idx;
-				return idx;
-			}
+			if( iter==_edgeTable.end() ) return _edgeTable[ _EdgeKey(v1,v2) ] = initializationFunction();
 			else return iter->second;
 		};
 	};
@@ -37,6 +37,7 @@ DAMAGE.
 #include <cstdarg>
 #include <vector>
 #include <limits>
+#include <chrono>
 #include <sys/timeb.h>
 #if defined( _WIN32 ) || defined( _WIN64 )
 #include <Windows.h>
@@ -63,6 +64,7 @@ DAMAGE.
 
 #endif // _WIN32 || _WIN64
 #include "Exceptions.h"
+#include "Trace.h"
 
 #ifndef M_PI
 #define M_PI		3.14159265358979323846
@@ -150,18 +152,9 @@ namespace MishaK
 		// Time Stuff //
 		////////////////
 
-		inline double Time( void )
-		{
-#if defined( _WIN32 ) || defined( _WIN64 )
-			struct _timeb t;
-			_ftime_s( &t );
-			return double( t.time ) + double( t.millitm ) / 1000.0;
-#else // !_WIN32 && !_WIN64
-			struct timeval t;
-			gettimeofday( &t , NULL );
-			return t.tv_sec + double( t.tv_usec ) / 1000000;
-#endif // _WIN32 || _WIN64
-		}
+		// The time, in seconds, on the monotonic (steady) clock
+		// [NOTE] The clock is not related to the time of day, so only differences between times are meaningful
+		inline double Time( void ){ return std::chrono::duration< double >( std::chrono::steady_clock::now().time_since_epoch() ).count(); }
 
 		struct Timer
 		{
@@ -414,12 +407,15 @@ namespace MishaK
 		{
 			inline static unsigned int Width = 30;
 
-			PerformanceMeter( char pad=' ' , unsigned int precision=2 ) : _depth( _Depth++ ) , _precision(precision) , _pad(pad) {}
+			PerformanceMeter( char pad=' ' , unsigned int precision=2 ) : _depth( _Depth++ ) , _precision(precision) , _pad(pad) { _resetTrace(); }
 			~PerformanceMeter( void ){ _Depth--; }
 
-			void reset( void ){ _timer.reset(); }
+			void reset( void ){ _timer.reset() , _resetTrace(); }
+
+			// [NOTE] If tracing is enabled, each call also records the interval since the last reset as an event named by the header
 			std::string operator()( std::string header , bool reset=true , bool showPerformance=true )
 			{
+				_trace( header , reset );
 				std::stringstream sStream;
 				unsigned int sz = (unsigned int)header.size();
 				unsigned int width = Width * (_depth-1);
@@ -442,6 +438,7 @@ namespace MishaK
 
 			std::string operator()( std::string header , std::string footer , bool reset=true , bool showPerformance=true )
 			{
+				_trace( header , reset );
 				std::stringstream sStream;
 				unsigned int sz = (unsigned int)header.size();
 				unsigned int width = Width * (_depth-1);
@@ -467,6 +464,19 @@ namespace MishaK
 			char _pad;
 			unsigned int _depth , _precision;
 			inline static unsigned int _Depth = 1;
+#ifdef MK_TRACE
+			long long _traceBegin;
+			void _resetTrace( void ){ _traceBegin = Trace::Now(); }
+			void _trace( const std::string & header , bool reset )
+			{
+				long long end = Trace::Now();
+				Trace::Record( header , _traceBegin , end );
+				if( reset ) _traceBegin = end;
+			}
+#else // !MK_TRACE
+			void _resetTrace( void ){}
+			void _trace( const std::string & , bool ){}
+#endif // MK_TRACE
 		};
 	}
 }
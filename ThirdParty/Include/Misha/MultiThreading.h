@@ -31,11 +31,24 @@ DAMAGE.
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#include <immintrin.h>
+#define MK_SPIN_PAUSE() _mm_pause()
+#else // !x86
+#define MK_SPIN_PAUSE() std::this_thread::yield()
+#endif // x86
 #ifdef _OPENMP
 #include <omp.h>
 #endif // _OPENMP
+#include "Trace.h"
 
 namespace MishaK
 {
@@ -54,6 +67,11 @@ namespace MishaK
 			STATIC ,
 			DYNAMIC
 		};
+		enum ScanType
+		{
+			EXCLUSIVE ,
+			INCLUSIVE
+		};
 
 #if 1 // NEW_CODE
 	protected:
@@ -83,38 +101,249 @@ namespace MishaK
 
 		static unsigned int NumThreads( void ){ return _NumThreads; }
 
-		template< typename Function , typename ... Functions >
-		static void ParallelSections( const Function &function , const Functions & ... functions )
+		// The number of consecutive elements reduced serially by ParallelReduce and ParallelScan
+		// [NOTE] The partition of the range into blocks does not depend on the number of threads, and the block results are combined in order,
+		// so the results are bitwise identical for any number of threads and parallelization type.
+		static const inline size_t ReductionBlockSize = 1<<12;
+
+		// A set of tasks run by the work-stealing scheduler
+		// [NOTE] Tasks may themselves spawn and sync groups. A thread waiting in sync runs queued tasks (its own first, then stolen ones) rather than idling.
+		struct TaskGroup
 		{
-			std::vector< std::future< void > > futures;
-			if constexpr( sizeof ... (Functions) )
+			TaskGroup( void ) = default;
+			TaskGroup( const TaskGroup & ) = delete;
+			TaskGroup &operator = ( const TaskGroup & ) = delete;
+			~TaskGroup( void ){ _wait(); }
+
+			// Queues a copy of the function to be run asynchronously
+			template< typename Function >
+			void spawn( Function &&function )
 			{
-				futures.reserve( sizeof...(Functions) );
-				_ParallelSections( futures , functions... );
+				using F = std::decay_t< Function >;
+				_spawn( _RunOwned< F > , new F( std::forward< Function >( function ) ) , 0 );
+			}
+
+			// Waits for all the spawned tasks to complete and re-throws the first exception thrown by any of them
+			void sync( void )
+			{
+				_wait();
+				if( _exception )
+				{
+					std::exception_ptr exception = _exception;
+					_exception = nullptr;
+					_failed.clear();
+					std::rethrow_exception( exception );
+				}
 			}
+
+		protected:
+			friend struct ThreadPool;
+
+			std::atomic< size_t > _pending = 0;
+			std::atomic_flag _failed = ATOMIC_FLAG_INIT;
+			std::exception_ptr _exception;
+
+			// Queues a call to run( context , argument ), without taking ownership of the context
+			void _spawn( void ( *run )( const void * , size_t ) , const void *context , size_t argument )
+			{
+				_pending.fetch_add( 1 , std::memory_order_relaxed );
+				_Scheduler::Get().push( _Task{ run , context , argument , this } );
+			}
+
+			void _wait( void )
+			{
+				_Scheduler &scheduler = _Scheduler::Get();
+				for( unsigned int spins=0 ; _pending.load( std::memory_order_acquire ) ; )
+					if     ( scheduler.tryRun()   ) spins = 0;
+					else if( spins++<_SpinCount ) MK_SPIN_PAUSE();
+					else                          std::this_thread::yield();
+			}
+
+			template< typename Function >
+			static void _RunOwned( const void *context , size_t ){ std::unique_ptr< const Function > function( static_cast< const Function * >( context ) ) ; (*function)(); }
+		};
+
+		// A bump allocator for scratch memory that is released all at once
+		// [NOTE] Memory is handed out from large blocks and is never freed individually. Resetting consolidates the blocks into a single one,
+		// so once an arena has grown to its high-water mark, allocating from it no longer touches the heap.
+		struct Arena
+		{
+			Arena( size_t blockSize=1<<16 ) : _blockSize(blockSize){}
+			Arena( const Arena & ) = delete;
+			Arena &operator = ( const Arena & ) = delete;
+			~Arena( void ){ _release(); }
+
+			// Returns uninitialized memory of the prescribed size and alignment
+			void *allocate( size_t size , size_t alignment=alignof( std::max_align_t ) )
+			{
+				char *p = _current ? _Align( _current , alignment ) : nullptr;
+				if( !p || p+size>_end )
+				{
+					_addBlock( size + alignment );
+					p = _Align( _current , alignment );
+				}
+				_current = p + size;
+				_allocations++;
+				return p;
+			}
+
+			// Returns uninitialized memory for the prescribed number of elements
+			template< typename T >
+			T *allocate( size_t count ){ return static_cast< T * >( allocate( sizeof(T)*count , alignof(T) ) ); }
+
+			// Makes all the memory available again, invalidating everything that was handed out
+			void reset( void )
+			{
+				if( _head && _head->next )
+				{
+					const size_t capacity = _capacity;
+					_release();
+					_addBlock( capacity );
+				}
+				else if( _head ) _current = _head->data() , _end = _current + _head->size;
+			}
+
+			// The number of allocations served and the number of blocks requested from the heap, since construction
+			size_t allocations( void ) const { return _allocations; }
+			size_t heapAllocations( void ) const { return _heapAllocations; }
+
+			// The total size of the blocks
+			size_t capacity( void ) const { return _capacity; }
+
+			// Releases the memory allocated from the arena over the scope's lifetime when the scope ends
+			// [NOTE] Scopes are expected to nest. If the arena had to grow within a scope, the memory is only reclaimed (and the blocks consolidated)
+			// when a scope that started with an empty arena ends.
+			struct Scope
+			{
+				Scope( Arena &arena ) : _arena(arena) , _head(arena._head) , _current(arena._current) , _end(arena._end) , _empty( arena._empty() ){}
+				~Scope( void )
+				{
+					if( _empty ) _arena.reset();
+					else if( _arena._head==_head ) _arena._current = _current , _arena._end = _end;
+				}
+				Scope( const Scope & ) = delete;
+				Scope &operator = ( const Scope & ) = delete;
+			protected:
+				Arena &_arena;
+				const void *_head;
+				char *_current , *_end;
+				bool _empty;
+			};
+
+		protected:
+			struct _Block
+			{
+				_Block *next;
+				size_t size;
+				char *data( void ){ return reinterpret_cast< char * >( this+1 ); }
+			};
+
+			const size_t _blockSize;
+			_Block *_head = nullptr;
+			char *_current = nullptr , *_end = nullptr;
+			size_t _capacity = 0 , _allocations = 0 , _heapAllocations = 0;
+
+			bool _empty( void ) const { return !_head || ( !_head->next && _current==_head->data() ); }
+
+			static char *_Align( char *p , size_t alignment ){ return reinterpret_cast< char * >( ( reinterpret_cast< std::uintptr_t >( p ) + alignment - 1 ) & ~static_cast< std::uintptr_t >( alignment - 1 ) ); }
+
+			// Adds a block large enough for the request, growing geometrically
+			void _addBlock( size_t size )
+			{
+				size = std::max< size_t >( size , std::max< size_t >( _blockSize , _capacity ) );
+				_Block *block = static_cast< _Block * >( ::operator new( sizeof(_Block) + size ) );
+				block->next = _head , block->size = size;
+				_head = block;
+				_current = block->data() , _end = _current + size;
+				_capacity += size;
+				_heapAllocations++;
+				_HeapAllocations.fetch_add( 1 , std::memory_order_relaxed );
+			}
+
+			void _release( void )
+			{
+				while( _head ){ _Block *next = _head->next ; ::operator delete( _head ) ; _head = next; }
+				_current = _end = nullptr;
+				_capacity = 0;
+			}
+		};
+
+		// An STL-compatible allocator drawing from an arena
+		// [NOTE] Dense Eigen types do not take allocators. Arena memory is used with them through Eigen::Map.
+		template< typename T >
+		struct ArenaAllocator
+		{
+			using value_type = T;
+
+			ArenaAllocator( Arena &arena ) : arena(&arena){}
+			template< typename U > ArenaAllocator( const ArenaAllocator< U > &allocator ) : arena(allocator.arena){}
+
+			T *allocate( size_t count ){ return arena->template allocate< T >( count ); }
+			void deallocate( T * , size_t ){}
+
+			template< typename U > bool operator == ( const ArenaAllocator< U > &allocator ) const { return arena==allocator.arena; }
+			template< typename U > bool operator != ( const ArenaAllocator< U > &allocator ) const { return arena!=allocator.arena; }
+
+			Arena *arena;
+		};
+
+		// The scratch arena of the calling thread
+		// [NOTE] The arena belongs to the (OS) thread, not to a loop's thread index, so nested and concurrent loops never share one.
+		// Allocations should be made within an Arena::Scope, which releases them when it ends.
+		static Arena &ThreadArena( void )
+		{
+			static thread_local Arena arena;
+			return arena;
+		}
+
+		// The number of blocks requested from the heap by all arenas
+		static size_t ArenaHeapAllocations( void ){ return _HeapAllocations.load( std::memory_order_relaxed ); }
+
+		template< typename Function , typename ... Functions >
+		static void ParallelSections( const Function &function , const Functions & ... functions )
+		{
+			TaskGroup group;
+			( group._spawn( _Call< Functions > , &functions , 0 ) , ... );
 			function();
-			for( unsigned int i=0 ; i<futures.size() ; i++ ) futures[i].get();
+			group.sync();
 		}
 
 		template< typename Function , typename ... Functions >
 		static void ParallelSections( const Function &&function , const Functions && ... functions )
 		{
-			std::vector< std::future< void > > futures;
-			if constexpr( sizeof ... (Functions) )
-			{
-				futures.reserve( sizeof...(Functions) );
-				_ParallelSections( futures , std::move(functions)... );
-			}
+			TaskGroup group;
+			( group._spawn( _Call< Functions > , &functions , 0 ) , ... );
 			function();
-			for( unsigned int i=0 ; i<futures.size() ; i++ ) futures[i].get();
+			group.sync();
 		}
 
 		template< typename Kernel /* = std::function< void ( unsigned int , size_t ) >*/ >
 		static void ParallelFor( size_t begin , size_t end , Kernel && kernel , unsigned int numThreads=_NumThreads , ParallelType pType=ParallelizationType , ScheduleType schedule=Schedule , size_t chunkSize=ChunkSize )
 		{
-			static_assert( std::is_convertible_v< Kernel , std::function< void ( unsigned int , size_t  ) > > || std::is_convertible_v< Kernel , std::function< void ( size_t  ) > > , "[ERROR] Kernel poorly formed" );
-			static const bool NeedsThread = std::is_convertible_v< Kernel , std::function< void ( unsigned int , size_t  ) > >;
+			static_assert( std::is_invocable_v< Kernel , unsigned int , size_t > || std::is_invocable_v< Kernel , size_t > , "[ERROR] Kernel poorly formed" );
+			static const bool NeedsThread = std::is_invocable_v< Kernel , unsigned int , size_t >;
+
+			ParallelForChunks
+				(
+					begin , end ,
+					[&]( unsigned int thread , size_t _begin , size_t _end )
+					{
+						for( size_t i=_begin ; i<_end ; i++ )
+							if constexpr( NeedsThread ) kernel( thread , i );
+							else                        kernel( i );
+					} ,
+					numThreads , pType , schedule , chunkSize
+				);
+		}
+
+		// Partitions [begin,end) into chunks and calls the kernel once per chunk with the chunk's sub-range, so that the loop over the sub-range can be inlined and vectorized
+		template< typename Kernel /* = std::function< void ( unsigned int , size_t , size_t ) >*/ >
+		static void ParallelForChunks( size_t begin , size_t end , Kernel && kernel , unsigned int numThreads=_NumThreads , ParallelType pType=ParallelizationType , ScheduleType schedule=Schedule , size_t chunkSize=ChunkSize )
+		{
+			static_assert( std::is_invocable_v< Kernel , unsigned int , size_t , size_t > || std::is_invocable_v< Kernel , size_t , size_t > , "[ERROR] Kernel poorly formed" );
+			static const bool NeedsThread = std::is_invocable_v< Kernel , unsigned int , size_t , size_t >;
 			if( begin>=end ) return;
+			MK_TRACE_SCOPE( "ParallelFor" );
 			size_t range = end - begin;
 			size_t chunks = ( range + chunkSize - 1 ) / chunkSize;
 			std::atomic< size_t > index;
@@ -123,9 +352,8 @@ namespace MishaK
 			// If the computation is serial, go ahead and run it
 			if( pType==ParallelType::NONE || numThreads<=1 )
 			{
-				for( size_t i=begin ; i<end ; i++ )
-					if constexpr( NeedsThread ) kernel( 0 , i );
-					else                        kernel( i );
+				if constexpr( NeedsThread ) kernel( 0 , begin , end );
+				else                        kernel( begin , end );
 				return;
 			}
 
@@ -136,30 +364,26 @@ namespace MishaK
 				chunks = numThreads = (unsigned int)( ( range + chunkSize - 1 ) / chunkSize );
 			}
 
-			std::function< void (unsigned int , size_t ) > _ChunkFunction = [ &kernel , begin , end , chunkSize ]( unsigned int thread , size_t chunk )
+			// [NOTE] The per-chunk and per-thread functions are lambdas rather than std::function objects so that dispatching does not allocate
+			auto _ChunkFunction = [ &kernel , begin , end , chunkSize ]( unsigned int thread , size_t chunk )
 				{
 					const size_t _begin = begin + chunkSize*chunk;
 					const size_t _end = std::min< size_t >( end , _begin+chunkSize );
-					for( size_t i=_begin ; i<_end ; i++ )
-						if constexpr( NeedsThread ) kernel( thread , i );
-						else                        kernel( i );
+					if constexpr( NeedsThread ) kernel( thread , _begin , _end );
+					else                        kernel( _begin , _end );
 				};
 
-			std::function< void (unsigned int ) > _StaticThreadFunction = [ &_ChunkFunction , chunks , numThreads ]( unsigned int thread )
+			auto ThreadFunction = [ &_ChunkFunction , chunks , numThreads , schedule , &index ]( unsigned int thread )
 				{
-					for( size_t chunk=thread ; chunk<chunks ; chunk+=numThreads ) _ChunkFunction( thread , chunk );
+					MK_TRACE_SCOPE( "ParallelFor (thread)" );
+					if( schedule==ScheduleType::STATIC ) for( size_t chunk=thread ; chunk<chunks ; chunk+=numThreads ) _ChunkFunction( thread , chunk );
+					else
+					{
+						size_t chunk;
+						while( ( chunk=index.fetch_add(1) )<chunks ) _ChunkFunction( thread , chunk );
+					}
 				};
 
-			std::function< void (unsigned int ) > _DynamicThreadFunction = [ &_ChunkFunction , chunks , &index ]( unsigned int thread )
-				{
-					size_t chunk;
-					while( ( chunk=index.fetch_add(1) )<chunks ) _ChunkFunction( thread , chunk );
-				};
-
-			std::function< void (unsigned int ) > ThreadFunction;
-			if     ( schedule==ScheduleType::STATIC  ) ThreadFunction = _StaticThreadFunction;
-			else if( schedule==ScheduleType::DYNAMIC ) ThreadFunction = _DynamicThreadFunction;
-
 			if( false ){}
 #ifdef _OPENMP
 			else if( pType==ParallelType::OPEN_MP )
@@ -174,15 +398,95 @@ namespace MishaK
 #endif // _OPENMP
 			else if( pType==ParallelType::ASYNC )
 			{
-				// [WARNING] Why static?
-				static std::vector< std::future< void > > futures;
-				futures.resize( numThreads-1 );
-				for( unsigned int t=1 ; t<numThreads ; t++ ) futures[t-1] = std::async( std::launch::async , ThreadFunction , t );
+				// [NOTE] The tasks only reference the thread function on the caller's stack, so no threads are created and nothing is allocated
+				TaskGroup group;
+				for( unsigned int t=1 ; t<numThreads ; t++ ) group._spawn( _RunThread< decltype(ThreadFunction) > , &ThreadFunction , t );
 				ThreadFunction( 0 );
-				for( unsigned int t=1 ; t<numThreads ; t++ ) futures[t-1].get();
+				group.sync();
 			}
 		}
 
+		// Returns reduce( ... reduce( reduce( identity , value(begin) ) , value(begin+1) ) ... , value(end-1) ), with the range processed in fixed-size blocks
+		template< typename T , typename Value /* = std::function< T ( size_t ) > */ , typename Reduce /* = std::function< T ( const T & , const T & ) > */ >
+		static T ParallelReduce( size_t begin , size_t end , Value && value , const T &identity , Reduce && reduce , size_t blockSize=ReductionBlockSize , unsigned int numThreads=_NumThreads , ParallelType pType=ParallelizationType )
+		{
+			if( begin>=end ) return identity;
+			const size_t blocks = ( end - begin + blockSize - 1 ) / blockSize;
+
+			// [NOTE] The per-block reductions are stored in the calling thread's arena, so that repeated reductions do not allocate once it has grown
+			Arena &arena = ThreadArena();
+			Arena::Scope scope( arena );
+			T *partials = arena.allocate< T >( blocks );
+			std::uninitialized_fill_n( partials , blocks , identity );
+			T result = _ParallelReduce( begin , end , value , identity , reduce , partials , blockSize , numThreads , pType );
+			std::destroy_n( partials , blocks );
+			return result;
+		}
+
+		// As above, with the per-block reductions stored in the prescribed buffer, so that repeated reductions do not allocate once it has grown
+		template< typename T , typename Value /* = std::function< T ( size_t ) > */ , typename Reduce /* = std::function< T ( const T & , const T & ) > */ >
+		static T ParallelReduce( size_t begin , size_t end , Value && value , const T &identity , Reduce && reduce , std::vector< T > &partials , size_t blockSize=ReductionBlockSize , unsigned int numThreads=_NumThreads , ParallelType pType=ParallelizationType )
+		{
+			if( begin>=end ) return identity;
+			partials.resize( ( end - begin + blockSize - 1 ) / blockSize );
+			return _ParallelReduce( begin , end , value , identity , reduce , partials.data() , blockSize , numThreads , pType );
+		}
+
+		// Calls output( i , s_i ) for every i in [begin,end), where s_i is the reduction of value(j) over j<i (exclusive) or j<=i (inclusive), and returns the reduction over the whole range
+		// [NOTE] The values are read before the outputs are written, so the output can overwrite the values in place.
+		template< typename T , typename Value /* = std::function< T ( size_t ) > */ , typename Output /* = std::function< void ( size_t , const T & ) > */ , typename Reduce=std::plus< T > >
+		static T ParallelScan( size_t begin , size_t end , Value && value , Output && output , ScanType type , const T &identity=T() , Reduce reduce=Reduce() , size_t blockSize=ReductionBlockSize , unsigned int numThreads=_NumThreads , ParallelType pType=ParallelizationType )
+		{
+			if( begin>=end ) return identity;
+			const size_t blocks = ( end - begin + blockSize - 1 ) / blockSize;
+
+			// Reduce the blocks
+			// [NOTE] The block offsets are stored in the calling thread's arena, so that repeated scans do not allocate once it has grown
+			Arena &arena = ThreadArena();
+			Arena::Scope scope( arena );
+			T *offsets = arena.allocate< T >( blocks+1 );
+			std::uninitialized_fill_n( offsets , blocks+1 , identity );
+			ParallelFor
+				(
+					0 , blocks ,
+					[&]( size_t b )
+					{
+						const size_t _begin = begin + b*blockSize , _end = std::min< size_t >( end , _begin+blockSize );
+						T &partial = offsets[b+1];
+						for( size_t i=_begin ; i<_end ; i++ ) partial = reduce( partial , value(i) );
+					} ,
+					numThreads , pType , ScheduleType::DYNAMIC , 1
+				);
+
+			// Scan the block reductions
+			for( size_t b=0 ; b<blocks ; b++ ) offsets[b+1] = reduce( offsets[b] , offsets[b+1] );
+
+			// Scan within the blocks, starting from the blocks' offsets
+			// [NOTE] The total is taken from the running sum of the last block so that it matches the last inclusive output exactly
+			T total = identity;
+			ParallelFor
+				(
+					0 , blocks ,
+					[&]( size_t b )
+					{
+						const size_t _begin = begin + b*blockSize , _end = std::min< size_t >( end , _begin+blockSize );
+						T sum = offsets[b];
+						for( size_t i=_begin ; i<_end ; i++ )
+							if( type==ScanType::INCLUSIVE ) sum = reduce( sum , value(i) ) , output( i , sum );
+							else
+							{
+								T _sum = reduce( sum , value(i) );
+								output( i , sum );
+								sum = _sum;
+							}
+						if( b==blocks-1 ) total = sum;
+					} ,
+					numThreads , pType , ScheduleType::DYNAMIC , 1
+				);
+			std::destroy_n( offsets , blocks+1 );
+
+			return total;
+		}
 
 	private:
 #if 1 // NEW_CODE
@@ -190,19 +494,204 @@ namespace MishaK
 		static unsigned int _NumThreads;
 #endif // NEW_CODE
 
-		template< typename Function , typename ... Functions >
-		static void _ParallelSections( std::vector< std::future< void > > &futures , const Function &function , const Functions & ... functions )
+		// The number of times a thread polls before yielding/blocking
+		static const unsigned int _SpinCount = 1<<12;
+
+		static inline std::atomic< size_t > _HeapAllocations = 0;
+
+		// The index of the deque the current thread pushes to (-1 for threads that are not workers)
+		static inline thread_local unsigned int _CurrentDeque = static_cast< unsigned int >( -1 );
+
+		// Reduces the blocks of the range into the (constructed) partials and returns the reduction of the partials
+		// [NOTE] Each block is reduced into a local, so that the inner loop does not write to memory, and the result is only written once per block
+		template< typename T , typename Value , typename Reduce >
+		static T _ParallelReduce( size_t begin , size_t end , Value &value , const T &identity , Reduce &reduce , T *partials , size_t blockSize , unsigned int numThreads , ParallelType pType )
 		{
-			futures.push_back( std::async( std::launch::async , function ) );
-			if constexpr( sizeof...(Functions) ) _ParallelSections( futures , functions... );
+			const size_t blocks = ( end - begin + blockSize - 1 ) / blockSize;
+			ParallelFor
+				(
+					0 , blocks ,
+					[&]( size_t b )
+					{
+						const size_t _begin = begin + b*blockSize , _end = std::min< size_t >( end , _begin+blockSize );
+						T partial = identity;
+						for( size_t i=_begin ; i<_end ; i++ ) partial = reduce( partial , value(i) );
+						partials[b] = partial;
+					} ,
+					numThreads , pType , ScheduleType::DYNAMIC , 1
+				);
+
+			T result = identity;
+			for( size_t b=0 ; b<blocks ; b++ ) result = reduce( result , partials[b] );
+			return result;
 		}
 
-		template< typename Function , typename ... Functions >
-		static void _ParallelSections( std::vector< std::future< void > > &futures , const Function &&function , const Functions && ... functions )
+		template< typename Function >
+		static void _Call( const void *context , size_t ){ ( *static_cast< const Function * >( context ) )(); }
+
+		template< typename ThreadFunction >
+		static void _RunThread( const void *context , size_t thread ){ ( *static_cast< const ThreadFunction * >( context ) )( static_cast< unsigned int >( thread ) ); }
+
+		// A type-erased task, recording the group it belongs to
+		struct _Task
 		{
-			futures.push_back( std::async( std::launch::async , function ) );
-			if constexpr( sizeof...(Functions) ) _ParallelSections( futures , std::move(functions)... );
-		}
+			void ( *run )( const void * , size_t );
+			const void *context;
+			size_t argument;
+			TaskGroup *group;
+
+			// Runs the task, recording the first exception thrown in the group
+			// [NOTE] The group may be destroyed as soon as the pending count is decremented, so it is not touched after that
+			void execute( void ) const
+			{
+				try{ run( context , argument ); }
+				catch( ... ){ if( !group->_failed.test_and_set() ) group->_exception = std::current_exception(); }
+				group->_pending.fetch_sub( 1 , std::memory_order_release );
+			}
+		};
+
+		// A double-ended queue of tasks, with the owner working at the back and thieves stealing from the front
+		struct _Deque
+		{
+			void pushBack( const _Task &task )
+			{
+				std::lock_guard< std::mutex > lock( _mutex );
+				if( _size==_tasks.size() ) _grow();
+				_tasks[ ( _head + _size ) % _tasks.size() ] = task;
+				_size++;
+			}
+
+			bool popBack( _Task &task )
+			{
+				if( !_size.load( std::memory_order_relaxed ) ) return false;
+				std::lock_guard< std::mutex > lock( _mutex );
+				if( !_size ) return false;
+				_size--;
+				task = _tasks[ ( _head + _size ) % _tasks.size() ];
+				return true;
+			}
+
+			// [NOTE] Stealing does not wait on a contended deque, it moves on to the next one
+			bool popFront( _Task &task )
+			{
+				if( !_size.load( std::memory_order_relaxed ) ) return false;
+				std::unique_lock< std::mutex > lock( _mutex , std::try_to_lock );
+				if( !lock.owns_lock() || !_size ) return false;
+				task = _tasks[_head];
+				_head = ( _head + 1 ) % _tasks.size();
+				_size--;
+				return true;
+			}
+
+		protected:
+			std::mutex _mutex;
+			std::vector< _Task > _tasks;
+			size_t _head = 0;
+			std::atomic< size_t > _size = 0;
+
+			void _grow( void )
+			{
+				std::vector< _Task > tasks( std::max< size_t >( 2*_tasks.size() , 64 ) );
+				for( size_t i=0 ; i<_size ; i++ ) tasks[i] = _tasks[ ( _head + i ) % _tasks.size() ];
+				_tasks.swap( tasks );
+				_head = 0;
+			}
+		};
+
+		// A persistent set of worker threads, each with its own deque, that steal from one another when idle and are parked when there is no work
+		// [NOTE] Threads that are not workers push to a shared deque, which the workers steal from.
+		struct _Scheduler
+		{
+			static _Scheduler &Get( void )
+			{
+				static _Scheduler scheduler( std::max< unsigned int >( _NumThreads , 2 )-1 );
+				return scheduler;
+			}
+
+			_Scheduler( unsigned int numWorkers ) : _numWorkers( numWorkers ) , _deques( new _Deque[numWorkers+1] )
+			{
+				_threads.reserve( numWorkers );
+				for( unsigned int i=0 ; i<numWorkers ; i++ ) _threads.emplace_back( [this,i]( void ){ _loop(i); } );
+			}
+
+			~_Scheduler( void )
+			{
+				{
+					std::lock_guard< std::mutex > lock( _mutex );
+					_stop = true;
+				}
+				_condition.notify_all();
+				for( unsigned int i=0 ; i<_threads.size() ; i++ ) _threads[i].join();
+			}
+
+			void push( const _Task &task )
+			{
+				// [NOTE] The count is incremented before the task is visible so that it never under-flows
+				_queued.fetch_add( 1 );
+				_deques[ _current() ].pushBack( task );
+				if( _sleeping.load() )
+				{
+					{ std::lock_guard< std::mutex > lock( _mutex ); }
+					_condition.notify_one();
+				}
+			}
+
+			// Runs a single queued task, if there is one, preferring the most recently pushed task on the thread's own deque
+			bool tryRun( void )
+			{
+				_Task task{};
+				if( !_queued.load( std::memory_order_relaxed ) ) return false;
+
+				const unsigned int current = _current() , numDeques = _numWorkers+1;
+				bool found = _deques[current].popBack( task );
+				if( !found )
+				{
+					const unsigned int start = _random() % numDeques;
+					for( unsigned int d=0 ; d<numDeques && !found ; d++ ) if( (start+d)%numDeques!=current ) found = _deques[ (start+d)%numDeques ].popFront( task );
+				}
+				if( !found ) return false;
+				_queued.fetch_sub( 1 , std::memory_order_relaxed );
+				task.execute();
+				return true;
+			}
+
+		protected:
+			const unsigned int _numWorkers;
+			std::unique_ptr< _Deque[] > _deques;
+			std::vector< std::thread > _threads;
+			std::mutex _mutex;
+			std::condition_variable _condition;
+			std::atomic< size_t > _queued = 0;
+			std::atomic< unsigned int > _sleeping = 0;
+			std::atomic< bool > _stop = false;
+
+			unsigned int _current( void ) const { return _CurrentDeque<_numWorkers ? _CurrentDeque : _numWorkers; }
+
+			static unsigned int _random( void )
+			{
+				static thread_local unsigned int state = static_cast< unsigned int >( std::hash< std::thread::id >()( std::this_thread::get_id() ) ) | 1;
+				state ^= state<<13 , state ^= state>>17 , state ^= state<<5;
+				return state;
+			}
+
+			void _loop( unsigned int index )
+			{
+				_CurrentDeque = index;
+				while( !_stop.load( std::memory_order_relaxed ) )
+				{
+					if( tryRun() ) continue;
+
+					// Spin briefly so that back-to-back work does not pay for a kernel wake-up
+					for( unsigned int spins=0 ; spins<_SpinCount && !_queued.load( std::memory_order_relaxed ) && !_stop.load( std::memory_order_relaxed ) ; spins++ ) MK_SPIN_PAUSE();
+					if( _queued.load() ) continue;
+
+					std::unique_lock< std::mutex > lock( _mutex );
+					_sleeping++;
+					_condition.wait( lock , [&]( void ){ return _queued.load()!=0 || _stop; } );
+					_sleeping--;
+				}
+			}
+		};
 		};
 
 #if 1 // NEW_CODE
@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2025, Michael Kazhdan
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer. Redistributions in binary form must reproduce
+the above copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the distribution. 
+
+Neither the name of the Johns Hopkins University nor the names of its contributors
+may be used to endorse or promote products derived from this software without specific
+prior written permission. 
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO THE IMPLIED WARRANTIES 
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+*/
+#ifndef TRACE_INCLUDED
+#define TRACE_INCLUDED
+
+// Scoped tracing of the time spent in named regions of the code
+// -- Tracing is enabled by defining MK_TRACE (e.g. by compiling with "CFLAGS=-DMK_TRACE make"), otherwise the macros expand to nothing
+// -- MK_TRACE_SCOPE( name ) records the interval between its declaration and the end of the enclosing scope
+// -- The times are read off the monotonic (steady) clock, in nanoseconds
+// -- Each thread appends its events to its own buffer, so recording takes no locks and is only synchronized when a thread records its first event
+// -- On exit the events are written to the file named by the MK_TRACE_FILE environment variable (defaulting to "trace.json"),
+//    as CSV if the extension is ".csv" and as Chrome trace-event JSON (viewable in chrome://tracing or Perfetto) otherwise
+// [NOTE] The name passed to MK_TRACE_SCOPE is not copied, so it should be a string literal
+
+#ifdef MK_TRACE
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include "Exceptions.h"
+
+#define MK_TRACE_CONCATENATE_( a , b ) a ## b
+#define MK_TRACE_CONCATENATE( a , b ) MK_TRACE_CONCATENATE_( a , b )
+#define MK_TRACE_SCOPE( name ) MishaK::Trace::Scope MK_TRACE_CONCATENATE( _traceScope , __LINE__ )( name )
+
+namespace MishaK
+{
+	namespace Trace
+	{
+		// The time, in nanoseconds, on the monotonic clock
+		inline long long Now( void ){ return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count(); }
+
+		// Records that the calling thread spent the interval [begin,end] in the named region
+		inline void Record( const char * name , long long begin , long long end );
+
+		// Records the event, copying the name
+		inline void Record( const std::string & name , long long begin , long long end );
+
+		// Writes out all the events recorded so far
+		inline void Write( std::string fileName );
+
+		// The file the events are written to on exit (nothing is written if the name is empty)
+		inline std::string FileName = std::getenv( "MK_TRACE_FILE" ) ? std::string( std::getenv( "MK_TRACE_FILE" ) ) : std::string( "trace.json" );
+
+		struct Scope
+		{
+			Scope( const char * name ) : _name(name) , _begin( Now() ) {}
+			~Scope( void ){ Record( _name , _begin , Now() ); }
+			Scope( const Scope & ) = delete;
+			Scope & operator = ( const Scope & ) = delete;
+		protected:
+			const char * _name;
+			long long _begin;
+		};
+
+		struct _Event
+		{
+			const char * name;
+			long long begin , end;
+		};
+
+		// The events recorded by a single thread, stored in a linked list of fixed-size blocks
+		// -- Only the owning thread appends, publishing each event by (atomically) incrementing the block's size
+		// -- The blocks are never moved or freed, so the events can be read while the thread is still recording
+		struct _Buffer
+		{
+			static const size_t BlockSize = 1<<12;
+
+			struct Block
+			{
+				_Event events[ BlockSize ];
+				std::atomic< size_t > size;
+				std::atomic< Block * > next;
+				Block( void ) : size(0) , next(nullptr) {}
+			};
+
+			const unsigned int thread;
+			Block * const head;
+			_Buffer * next;
+
+			_Buffer( unsigned int thread ) : thread(thread) , head( new Block() ) , next(nullptr) , _tail(head) {}
+
+			void push( const char * name , long long begin , long long end )
+			{
+				size_t sz = _tail->size.load( std::memory_order_relaxed );
+				if( sz==BlockSize )
+				{
+					Block * block = new Block();
+					_tail->next.store( block , std::memory_order_release );
+					_tail = block;
+					sz = 0;
+				}
+				_tail->events[sz] = _Event{ name , begin , end };
+				_tail->size.store( sz+1 , std::memory_order_release );
+			}
+
+			// Returns a (persistent) copy of the name
+			// [NOTE] Elements of a std::deque are not moved when elements are added at the back
+			const char * copy( const std::string & name ){ _names.push_back( name ) ; return _names.back().c_str(); }
+
+			template< typename EventFunction /* = std::function< void ( const _Event & ) > */ >
+			void process( EventFunction F ) const
+			{
+				for( const Block * block=head ; block ; block=block->next.load( std::memory_order_acquire ) )
+				{
+					size_t sz = block->size.load( std::memory_order_acquire );
+					for( size_t i=0 ; i<sz ; i++ ) F( block->events[i] );
+				}
+			}
+
+		protected:
+			Block * _tail;
+			std::deque< std::string > _names;
+		};
+
+		// The list of all the threads' buffers
+		inline std::atomic< _Buffer * > _Buffers = nullptr;
+		inline std::atomic< unsigned int > _ThreadCount = 0;
+
+		struct _Writer{ ~_Writer( void ){ if( FileName.size() ) Write( FileName ); } };
+
+		inline _Buffer & _ThreadBuffer( void )
+		{
+			thread_local _Buffer * buffer = nullptr;
+			if( !buffer )
+			{
+				// [NOTE] The writer is constructed when the first event is recorded, so that it is destroyed (and the events written) before the file name
+				static _Writer writer;
+				buffer = new _Buffer( _ThreadCount++ );
+				buffer->next = _Buffers.load( std::memory_order_relaxed );
+				while( !_Buffers.compare_exchange_weak( buffer->next , buffer , std::memory_order_release , std::memory_order_relaxed ) );
+			}
+			return *buffer;
+		}
+
+		inline void Record( const char * name , long long begin , long long end ){ _ThreadBuffer().push( name , begin , end ); }
+
+		inline void Record( const std::string & name , long long begin , long long end )
+		{
+			_Buffer & buffer = _ThreadBuffer();
+			buffer.push( buffer.copy( name ) , begin , end );
+		}
+
+		// Escapes the quotes (and, for JSON, the backslashes) in the name and drops control characters
+		inline std::string _Escape( const char * name , bool json )
+		{
+			std::string escaped;
+			for( const char * c=name ; *c ; c++ )
+				if     ( *c=='"'  ) escaped += json ? "\\\"" : "\"\"";
+				else if( *c=='\\' ) escaped += json ? "\\\\" : "\\";
+				else if( (unsigned char)*c>=' ' ) escaped += *c;
+			return escaped;
+		}
+
+		inline void Write( std::string fileName )
+		{
+			std::string ext = fileName.substr( std::min< size_t >( fileName.size() , fileName.find_last_of( '.' ) ) );
+			std::transform( ext.begin() , ext.end() , ext.begin() , []( char c ){ return (char)std::tolower( c ); } );
+			bool csv = ext==std::string( ".csv" );
+
+			FILE * fp = fopen( fileName.c_str() , "w" );
+			if( !fp ){ MK_WARN( "Failed to open trace file for writing: " , fileName ) ; return; }
+
+			// Report the times relative to the first recorded event
+			long long origin = std::numeric_limits< long long >::max();
+			for( const _Buffer * b=_Buffers.load( std::memory_order_acquire ) ; b ; b=b->next ) b->process( [&]( const _Event & e ){ origin = std::min< long long >( origin , e.begin ); } );
+
+			bool first = true;
+			if( csv ) fprintf( fp , "thread,name,begin (us),duration (us)\n" );
+			else      fprintf( fp , "{\"traceEvents\":[" );
+			for( const _Buffer * b=_Buffers.load( std::memory_order_acquire ) ; b ; b=b->next ) b->process
+				(
+					[&]( const _Event & e )
+					{
+						double ts = (double)( e.begin - origin ) / 1000. , dur = (double)( e.end - e.begin ) / 1000.;
+						if( csv ) fprintf( fp , "%u,\"%s\",%.3f,%.3f\n" , b->thread , _Escape( e.name , false ).c_str() , ts , dur );
+						else
+						{
+							fprintf( fp , "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}" , first ? "" : "," , _Escape( e.name , true ).c_str() , b->thread , ts , dur );
+							first = false;
+						}
+					}
+				);
+			if( !csv ) fprintf( fp , "\n],\"displayTimeUnit\":\"ms\"}\n" );
+			fclose( fp );
+		}
+	}
+}
+#else // !MK_TRACE
+#define MK_TRACE_SCOPE( name )
+#endif // MK_TRACE
+
+#endif // TRACE_INCLUDED